@@ -0,0 +1,508 @@
+﻿#pragma once
+#ifndef DYNARRAY_CHUNKED_HEADER_
+#define DYNARRAY_CHUNKED_HEADER_
+
+#include "DynArray.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+#include <cassert>
+#include <cstddef>
+
+template<typename T, size_t Dimension>
+class ChunkedDynArray;
+
+// ------------------- proxy class -------------------
+// indices gathered one axis at a time, the element is looked up with the last one
+template<typename Array, size_t Dimension, size_t Remaining>
+class ChunkedDynArrayRef
+{
+public:
+	ChunkedDynArrayRef(Array* owner, const size_t* index, size_t depth, size_t next) noexcept
+		: arr_owner(owner)
+	{
+		std::copy_n(index, depth, arr_index.data());
+		arr_index[depth] = next;
+	}
+
+	decltype(auto) operator[](size_t index) const
+	{
+		constexpr size_t depth = Dimension - Remaining;
+		assert(index < arr_owner->size(depth));
+		if constexpr (Remaining == 1)
+		{
+			arr_index[depth] = index;
+			return arr_owner->element(arr_index.data());
+		}
+		else
+			return ChunkedDynArrayRef<Array, Dimension, Remaining - 1>(arr_owner, arr_index.data(), depth, index);
+	}
+
+private:
+	Array* arr_owner;
+	mutable std::array<size_t, Dimension> arr_index{};
+};
+
+// one chunk during for_each_chunk, pinned in memory until the call returns
+template<typename T, size_t Dimension>
+class DynArrayChunk
+{
+public:
+	DynArrayChunk(T* data, const size_t* origin, const size_t* sizes, const size_t* remains) noexcept
+		: chunk_data(data), chunk_remains(remains)
+	{
+		std::copy_n(origin, Dimension, chunk_origin);
+		std::copy_n(sizes, Dimension, chunk_sizes);
+	}
+
+	// the index in the whole array of the first element of the chunk
+	size_t origin(size_t dimension = 0) const noexcept
+	{
+		assert(dimension < Dimension);
+		return chunk_origin[dimension];
+	}
+	// the chunks on the far edges may be cut short
+	size_t size(size_t dimension = 0) const noexcept
+	{
+		assert(dimension < Dimension);
+		return chunk_sizes[dimension];
+	}
+	DynArrayRef<T, Dimension> ref() const noexcept
+	{
+		return DynArrayRef<T, Dimension>(chunk_data, chunk_sizes, chunk_remains);
+	}
+	decltype(auto) operator[](size_t index) const noexcept
+	{
+		return ref()[index];
+	}
+
+private:
+	T* chunk_data;
+	const size_t* chunk_remains;
+	size_t chunk_origin[Dimension];
+	size_t chunk_sizes[Dimension];
+};
+
+/*
+ * A DynArray kept on disk in fixed-size N-D chunks, each stored contiguously
+ * in row-major order, for datasets larger than memory. Chunks are loaded into
+ * an LRU cache of cache_chunks entries, and modified ones are written back
+ * when evicted. When consecutive accesses move from chunk to chunk with a
+ * constant step, or when for_each_chunk walks the chunks, the next read_ahead
+ * chunks are read by a background I/O thread meanwhile, and write backs also
+ * happen there, so sweeps run at the speed of the disk.
+ *
+ * The file is created, or reused with its contents when it exists. One
+ * thread at a time may use the array. A reference from operator[] stays
+ * valid until the next access to another chunk. The non-const operator[]
+ * can't tell reads from writes, so it marks the chunk modified and the chunk
+ * is written back; read through std::as_const to avoid that.
+ */
+template<typename T, size_t Dimension = 1>
+class ChunkedDynArray
+{
+	static_assert(Dimension != 0, "The dimension of ChunkedDynArray should not be zero.");
+	static_assert(std::is_trivially_copyable_v<T>, "Chunks are stored as raw bytes.");
+	template<typename, size_t, size_t>
+	friend class ChunkedDynArrayRef;
+
+	using Buffer = std::shared_ptr<T[]>;
+	struct Entry
+	{
+		Buffer data;
+		std::list<size_t>::iterator age;
+		bool ready = false; // false while the I/O thread reads it
+		bool dirty = false;
+		size_t pins = 0;
+	};
+	struct Job
+	{
+		size_t chunk;
+		Buffer data;
+		bool write;
+	};
+
+public:
+	ChunkedDynArray(const std::filesystem::path& file, const std::array<size_t, Dimension>& sizes,
+					const std::array<size_t, Dimension>& chunk, size_t cache_chunks = 64, size_t read_ahead = 4)
+		: read_ahead(read_ahead)
+		, capacity(std::max(cache_chunks, read_ahead + 2))
+	{
+		chunk_elements = 1;
+		total_chunks = 1;
+		for (size_t d = Dimension; d-- > 0;)
+		{
+			assert(sizes[d] > 0 && chunk[d] > 0);
+			arr_sizes[d] = sizes[d];
+			chunk_sizes[d] = chunk[d];
+			chunk_remains[d] = chunk_elements;
+			grid_sizes[d] = (sizes[d] + chunk[d] - 1) / chunk[d];
+			grid_remains[d] = total_chunks;
+			chunk_elements *= chunk[d];
+			total_chunks *= grid_sizes[d];
+		}
+
+		const auto bytes = static_cast<std::uintmax_t>(total_chunks) * chunk_elements * sizeof(T);
+		if (!std::filesystem::exists(file))
+			std::ofstream(file, std::ios::binary);
+		if (std::filesystem::file_size(file) < bytes)
+			std::filesystem::resize_file(file, bytes); // the new chunks read as zeros
+		stream.open(file, std::ios::binary | std::ios::in | std::ios::out);
+		io_ok = static_cast<bool>(stream);
+		io_thread = std::thread([this] { work(); });
+	}
+
+	~ChunkedDynArray()
+	{
+		flush();
+		{
+			std::lock_guard lock(cache_mutex);
+			stopping = true;
+		}
+		jobs_changed.notify_all();
+		io_thread.join();
+	}
+
+	ChunkedDynArray(const ChunkedDynArray&) = delete;
+	ChunkedDynArray& operator=(const ChunkedDynArray&) = delete;
+
+	// writes every modified chunk back to the file and waits for it
+	void flush()
+	{
+		std::unique_lock lock(cache_mutex);
+		for (auto& [chunk, entry] : cache)
+		{
+			if (entry.ready && entry.dirty)
+			{
+				queue_write(chunk, entry.data);
+				entry.dirty = false;
+			}
+		}
+		last_dirty = false; // the next write has to mark its chunk again
+		chunk_loaded.wait(lock, [this] { return jobs.empty() && writing.empty() && !busy; });
+		std::lock_guard file(file_mutex);
+		stream.flush();
+	}
+
+	// false once a read or a write of the file has failed
+	bool good() const noexcept
+	{
+		return io_ok.load();
+	}
+
+public:
+	ChunkedDynArrayRef<ChunkedDynArray, Dimension, Dimension - 1> operator[](size_t index) requires (Dimension > 1)
+	{
+		assert(index < arr_sizes[0]);
+		return ChunkedDynArrayRef<ChunkedDynArray, Dimension, Dimension - 1>(this, nullptr, 0, index);
+	}
+	ChunkedDynArrayRef<const ChunkedDynArray, Dimension, Dimension - 1> operator[](size_t index) const requires (Dimension > 1)
+	{
+		assert(index < arr_sizes[0]);
+		return ChunkedDynArrayRef<const ChunkedDynArray, Dimension, Dimension - 1>(this, nullptr, 0, index);
+	}
+	// marks the chunk modified, see above
+	T& operator[](size_t index) requires (Dimension == 1)
+	{
+		assert(index < arr_sizes[0]);
+		return element(&index);
+	}
+	const T& operator[](size_t index) const requires (Dimension == 1)
+	{
+		assert(index < arr_sizes[0]);
+		return element(&index);
+	}
+	size_t size(size_t dimension = 0) const noexcept
+	{
+		assert(dimension < Dimension);
+		return arr_sizes[dimension];
+	}
+	size_t total_size() const noexcept
+	{
+		size_t total = 1;
+		for (size_t size : arr_sizes)
+			total *= size;
+		return total;
+	}
+	// how many chunks there are along an axis
+	size_t chunks(size_t dimension = 0) const noexcept
+	{
+		assert(dimension < Dimension);
+		return grid_sizes[dimension];
+	}
+
+	/*
+	 * for_each_chunk(fn) - fn(DynArrayChunk) for every chunk, in the order
+	 * they're stored, reading ahead of the walk. Only the chunks in the slab
+	 * [first, last) of the outermost axis of the chunk grid are visited when
+	 * given. Through the non-const array, every chunk is taken as modified.
+	 */
+	template<typename F>
+	void for_each_chunk(F&& fn, size_t first = 0, size_t last = size_t(-1))
+	{
+		walk_chunks<T>(fn, first, last, true);
+	}
+	template<typename F>
+	void for_each_chunk(F&& fn, size_t first = 0, size_t last = size_t(-1)) const
+	{
+		walk_chunks<const T>(fn, first, last, false);
+	}
+
+private:
+	template<typename U, typename F>
+	void walk_chunks(F& fn, size_t first, size_t last, bool modify) const
+	{
+		last = std::min(last, grid_sizes[0]);
+		if (first >= last)
+			return;
+		const size_t begin = first * grid_remains[0], end = last * grid_remains[0];
+		for (size_t chunk = begin; chunk < end; chunk++)
+		{
+			for (size_t ahead = chunk + 1; ahead < std::min(end, chunk + 1 + read_ahead); ahead++)
+				prefetch(ahead);
+			T* data = acquire(chunk);
+			size_t origin[Dimension], extent[Dimension];
+			for (size_t d = 0; d < Dimension; d++)
+			{
+				origin[d] = chunk / grid_remains[d] % grid_sizes[d] * chunk_sizes[d];
+				extent[d] = std::min(chunk_sizes[d], arr_sizes[d] - origin[d]);
+			}
+			{
+				std::lock_guard lock(cache_mutex);
+				auto& entry = cache.at(chunk);
+				entry.pins++;
+				entry.dirty |= modify;
+			}
+			struct Unpin
+			{
+				const ChunkedDynArray* self;
+				size_t chunk;
+				~Unpin()
+				{
+					std::lock_guard lock(self->cache_mutex);
+					self->cache.at(chunk).pins--;
+				}
+			} unpin{ this, chunk };
+			fn(DynArrayChunk<U, Dimension>(data, origin, extent, chunk_remains));
+		}
+	}
+
+	// the element at index, loading its chunk when it's not the last one used
+	T* locate(const size_t* index) const
+	{
+		size_t chunk = 0, offset = 0;
+		for (size_t d = 0; d < Dimension; d++)
+		{
+			chunk += index[d] / chunk_sizes[d] * grid_remains[d];
+			offset += index[d] % chunk_sizes[d] * chunk_remains[d];
+		}
+		if (chunk != last_chunk)
+		{
+			// a constant step between chunks is a sweep worth reading ahead of
+			const ptrdiff_t step = static_cast<ptrdiff_t>(chunk) - static_cast<ptrdiff_t>(last_chunk);
+			last_data = acquire(chunk);
+			last_chunk = chunk;
+			if (step == last_step)
+			{
+				for (size_t k = 1; k <= read_ahead; k++)
+				{
+					const ptrdiff_t ahead = static_cast<ptrdiff_t>(chunk) + step * static_cast<ptrdiff_t>(k);
+					if (ahead < 0 || ahead >= static_cast<ptrdiff_t>(total_chunks))
+						break;
+					prefetch(static_cast<size_t>(ahead));
+				}
+			}
+			last_step = step;
+		}
+		return last_data + offset;
+	}
+	const T& element(const size_t* index) const
+	{
+		return *locate(index);
+	}
+	T& element(const size_t* index)
+	{
+		T* item = locate(index);
+		if (!last_dirty)
+		{
+			std::lock_guard lock(cache_mutex);
+			cache.at(last_chunk).dirty = true;
+			last_dirty = true;
+		}
+		return *item;
+	}
+
+	// the data of a chunk, in the cache and the most recently used one when it returns
+	T* acquire(size_t chunk) const
+	{
+		std::unique_lock lock(cache_mutex);
+		last_dirty = false;
+		auto found = cache.find(chunk);
+		if (found == cache.end())
+		{
+			Entry& entry = insert(chunk);
+			entry.data = Buffer(new T[chunk_elements]);
+			if (auto pending = writing.find(chunk); pending != writing.end())
+				std::copy_n(pending->second.get(), chunk_elements, entry.data.get());
+			else
+			{
+				// read here rather than wait behind the queue of the I/O thread
+				Buffer data = entry.data;
+				lock.unlock();
+				read(chunk, data.get());
+				lock.lock();
+			}
+			found = cache.find(chunk);
+			found->second.ready = true;
+		}
+		Entry& entry = found->second;
+		chunk_loaded.wait(lock, [&] { return entry.ready; });
+		ages.splice(ages.begin(), ages, entry.age);
+		return entry.data.get();
+	}
+
+	// queues a read of a chunk that isn't cached yet
+	void prefetch(size_t chunk) const
+	{
+		std::lock_guard lock(cache_mutex);
+		if (cache.count(chunk) != 0)
+			return;
+		Entry& entry = insert(chunk);
+		entry.data = Buffer(new T[chunk_elements]);
+		if (auto pending = writing.find(chunk); pending != writing.end())
+		{
+			std::copy_n(pending->second.get(), chunk_elements, entry.data.get());
+			entry.ready = true;
+			return;
+		}
+		jobs.push_back(Job{ chunk, entry.data, false });
+		jobs_changed.notify_one();
+	}
+
+	// a new entry for a chunk, evicting the least recently used ones past the capacity
+	Entry& insert(size_t chunk) const
+	{
+		for (auto it = ages.end(); cache.size() >= capacity && it != ages.begin();)
+		{
+			auto victim = cache.find(*--it);
+			if (!victim->second.ready || victim->second.pins != 0 || victim->first == last_chunk)
+				continue;
+			if (victim->second.dirty)
+				queue_write(victim->first, std::move(victim->second.data));
+			it = ages.erase(it);
+			cache.erase(victim);
+		}
+		ages.push_front(chunk);
+		Entry& entry = cache[chunk];
+		entry.age = ages.begin();
+		return entry;
+	}
+
+	void queue_write(size_t chunk, Buffer data) const
+	{
+		writing[chunk] = data;
+		jobs.push_back(Job{ chunk, std::move(data), true });
+		jobs_changed.notify_one();
+	}
+
+	void read(size_t chunk, T* data) const
+	{
+		std::lock_guard lock(file_mutex);
+		stream.seekg(static_cast<std::streamoff>(chunk * chunk_elements * sizeof(T)));
+		if (!stream.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(chunk_elements * sizeof(T))))
+		{
+			std::fill_n(data, chunk_elements, T{});
+			stream.clear();
+			io_ok = false;
+		}
+	}
+
+	void write(size_t chunk, const T* data) const
+	{
+		std::lock_guard lock(file_mutex);
+		stream.seekp(static_cast<std::streamoff>(chunk * chunk_elements * sizeof(T)));
+		if (!stream.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(chunk_elements * sizeof(T))))
+		{
+			stream.clear();
+			io_ok = false;
+		}
+	}
+
+	// the I/O thread, which runs the jobs in the order they were queued
+	void work() const
+	{
+		std::unique_lock lock(cache_mutex);
+		while (true)
+		{
+			jobs_changed.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (jobs.empty())
+				return;
+			Job job = std::move(jobs.front());
+			jobs.pop_front();
+			busy = true;
+			lock.unlock();
+			if (job.write)
+				write(job.chunk, job.data.get());
+			else
+				read(job.chunk, job.data.get());
+			lock.lock();
+			busy = false;
+			if (job.write)
+			{
+				// a later write of the same chunk may be queued already
+				if (auto pending = writing.find(job.chunk); pending != writing.end() && pending->second == job.data)
+					writing.erase(pending);
+			}
+			else if (auto found = cache.find(job.chunk); found != cache.end() && found->second.data == job.data)
+				found->second.ready = true;
+			chunk_loaded.notify_all();
+		}
+	}
+
+	size_t arr_sizes[Dimension];
+	size_t chunk_sizes[Dimension];
+	size_t chunk_remains[Dimension];
+	size_t grid_sizes[Dimension];
+	size_t grid_remains[Dimension];
+	size_t chunk_elements;
+	size_t total_chunks;
+	size_t read_ahead;
+	size_t capacity;
+
+	// the cache, the job queue and the chunks being written back, all behind cache_mutex
+	mutable std::mutex cache_mutex;
+	mutable std::condition_variable jobs_changed;
+	mutable std::condition_variable chunk_loaded;
+	mutable std::unordered_map<size_t, Entry> cache;
+	mutable std::list<size_t> ages; // most recently used first
+	mutable std::deque<Job> jobs;
+	mutable std::unordered_map<size_t, Buffer> writing;
+	mutable bool busy = false;
+	bool stopping = false;
+
+	// the chunk of the previous access, owned by the thread using the array
+	mutable size_t last_chunk = size_t(-1);
+	mutable T* last_data = nullptr;
+	mutable ptrdiff_t last_step = 0;
+	mutable bool last_dirty = false;
+
+	mutable std::mutex file_mutex;
+	mutable std::fstream stream;
+	mutable std::atomic<bool> io_ok{ true };
+	std::thread io_thread;
+};
+
+#endif // DYNARRAY_CHUNKED_HEADER_
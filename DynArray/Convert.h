@@ -0,0 +1,315 @@
+﻿#pragma once
+#ifndef DYNARRAY_CONVERT_HEADER_
+#define DYNARRAY_CONVERT_HEADER_
+
+#include "DynArray.h"
+#include "Reduce.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <cassert>
+#include <cstddef>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// ---------------- detail functions -----------------
+namespace detail {
+	// IEEE binary16, rounding to nearest even, the same as F16C does
+	inline uint16_t FloatToHalf(float value) noexcept
+	{
+		uint32_t bits = std::bit_cast<uint32_t>(value);
+		const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+		bits &= 0x7FFFFFFF;
+		if (bits >= 0x7F800000) // infinity, or a NaN kept quiet with the top of its payload
+			return sign | 0x7C00 | (bits > 0x7F800000 ? 0x200 | ((bits >> 13) & 0x3FF) : 0);
+		if (bits >= 0x477FF000) // from halfway between 65504 and 65536 on
+			return sign | 0x7C00;
+		if (bits < 0x38800000)
+		{
+			// subnormal: adding 0.5 leaves exactly the precision of a subnormal half to round to
+			const float shifted = std::bit_cast<float>(bits) + 0.5F;
+			return sign | static_cast<uint16_t>(std::bit_cast<uint32_t>(shifted) - 0x3F000000);
+		}
+		const uint32_t odd = (bits >> 13) & 1;
+		bits += 0xFFF + odd - (112u << 23); // rebias the exponent, round the 13 bits dropped
+		return sign | static_cast<uint16_t>(bits >> 13);
+	}
+
+	inline float HalfToFloat(uint16_t half) noexcept
+	{
+		const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+		const uint32_t exponent = (half >> 10) & 0x1F;
+		const uint32_t mantissa = half & 0x3FF;
+		if (exponent == 0x1F)
+			return std::bit_cast<float>(sign | 0x7F800000 | (mantissa << 13) | (mantissa ? 0x400000 : 0));
+		if (exponent == 0)
+		{
+			const float magnitude = static_cast<float>(mantissa) * 0x1p-24F; // exact
+			return sign ? -magnitude : magnitude;
+		}
+		return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+	}
+
+	// the upper half of a float, rounding to nearest even; branch free so that loops vectorize
+	inline uint16_t FloatToBFloat16(float value) noexcept
+	{
+		const uint32_t bits = std::bit_cast<uint32_t>(value);
+		const uint32_t rounded = (bits + 0x7FFF + ((bits >> 16) & 1)) >> 16;
+		const uint32_t quiet = (bits >> 16) | 0x40;
+		return static_cast<uint16_t>((bits & 0x7FFFFFFF) > 0x7F800000 ? quiet : rounded);
+	}
+
+	inline float BFloat16ToFloat(uint16_t value) noexcept
+	{
+		return std::bit_cast<float>(static_cast<uint32_t>(value) << 16);
+	}
+}
+
+// 16-bit floats for storage, converted from and to float
+struct half
+{
+	half() = default;
+	explicit half(float value) noexcept
+		: bits(::detail::FloatToHalf(value))
+	{}
+	explicit operator float() const noexcept
+	{
+		return ::detail::HalfToFloat(bits);
+	}
+
+	uint16_t bits;
+};
+
+struct bfloat16
+{
+	bfloat16() = default;
+	explicit bfloat16(float value) noexcept
+		: bits(::detail::FloatToBFloat16(value))
+	{}
+	explicit operator float() const noexcept
+	{
+		return ::detail::BFloat16ToFloat(bits);
+	}
+
+	uint16_t bits;
+};
+
+// how integers stand for real numbers: real = (integer - zero_point) * scale
+struct Quantization
+{
+	float scale = 1;
+	int zero_point = 0;
+};
+
+namespace detail {
+	template<typename T>
+	constexpr bool IsStorageFloat = std::is_same_v<T, half> || std::is_same_v<T, bfloat16>;
+	template<typename T>
+	constexpr bool IsFloating = std::is_floating_point_v<T> || IsStorageFloat<T>;
+
+	// elements converted by one task
+	constexpr size_t ConvertChunk = 1 << 14;
+
+	// float, or double when it's on either side
+	template<typename U, typename T>
+	using ConvertWork = std::conditional_t<std::is_same_v<U, double> || std::is_same_v<T, double>, double, float>;
+
+	template<typename W, typename T>
+	inline W ToWork(T value) noexcept
+	{
+		if constexpr (IsStorageFloat<T>)
+			return static_cast<W>(static_cast<float>(value));
+		else
+			return static_cast<W>(value);
+	}
+
+	template<typename U, typename W>
+	inline U FromWork(W value) noexcept
+	{
+		if constexpr (IsStorageFloat<U>)
+			return U(static_cast<float>(value));
+		else
+			return static_cast<U>(value);
+	}
+
+	/*
+	 * One element. Into an integer: divided by the scale, saturated, rounded
+	 * to nearest even and offset by the zero point, NaN gives the lowest
+	 * value. From an integer: the zero point is taken away before scaling.
+	 * Between integers the value is only saturated.
+	 */
+	template<typename U, typename T>
+	inline U ConvertOne(T value, const Quantization& q) noexcept
+	{
+		using W = ConvertWork<U, T>;
+		if constexpr (std::is_integral_v<U> && std::is_integral_v<T>)
+		{
+			return static_cast<U>(std::clamp<long long>(static_cast<long long>(value),
+														std::numeric_limits<U>::min(), std::numeric_limits<U>::max()));
+		}
+		else if constexpr (std::is_integral_v<U>)
+		{
+			const W low = static_cast<W>(std::numeric_limits<U>::min()) - static_cast<W>(q.zero_point);
+			const W high = static_cast<W>(std::numeric_limits<U>::max()) - static_cast<W>(q.zero_point);
+			W scaled = ToWork<W>(value) / static_cast<W>(q.scale);
+			scaled = scaled >= low ? scaled : low; // NaN fails every comparison
+			scaled = scaled <= high ? scaled : high;
+			const long long rounded = static_cast<long long>(std::nearbyint(scaled)) + q.zero_point;
+			return static_cast<U>(std::clamp<long long>(rounded, std::numeric_limits<U>::min(), std::numeric_limits<U>::max()));
+		}
+		else if constexpr (std::is_integral_v<T>)
+			return FromWork<U>(static_cast<W>(static_cast<long long>(value) - q.zero_point) * static_cast<W>(q.scale));
+		else
+			return FromWork<U>(ToWork<W>(value));
+	}
+
+#if defined(__AVX2__)
+	template<typename U>
+	constexpr bool IsSmallInteger = std::is_same_v<U, int8_t> || std::is_same_v<U, uint8_t> ||
+		std::is_same_v<U, int16_t> || std::is_same_v<U, uint16_t>;
+
+	// eight floats quantized into int32 lanes, the same steps as ConvertOne
+	template<typename U>
+	inline __m256i QuantizeLanes(const float* src, __m256 scale, __m256 low, __m256 high, __m256i zero_point) noexcept
+	{
+		__m256 scaled = _mm256_div_ps(_mm256_loadu_ps(src), scale);
+		scaled = _mm256_min_ps(_mm256_max_ps(scaled, low), high); // max takes low for NaN
+		return _mm256_add_epi32(_mm256_cvtps_epi32(scaled), zero_point);
+	}
+
+	// eight integers widened to int32 lanes
+	template<typename T>
+	inline __m256i WidenLanes(const T* src) noexcept
+	{
+		if constexpr (sizeof(T) == 1)
+		{
+			const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+			return std::is_signed_v<T> ? _mm256_cvtepi8_epi32(bytes) : _mm256_cvtepu8_epi32(bytes);
+		}
+		else
+		{
+			const __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			return std::is_signed_v<T> ? _mm256_cvtepi16_epi32(words) : _mm256_cvtepu16_epi32(words);
+		}
+	}
+#endif
+
+	// converts a prefix of [0, count) with vector instructions, returns its length
+	template<typename U, typename T>
+	inline size_t ConvertVector(const T* src, U* dst, size_t count, const Quantization& q) noexcept
+	{
+		size_t i = 0;
+#if defined(__AVX2__)
+		if constexpr (std::is_same_v<T, float> && IsSmallInteger<U>)
+		{
+			const __m256 scale = _mm256_set1_ps(q.scale);
+			const __m256 low = _mm256_set1_ps(static_cast<float>(std::numeric_limits<U>::min()) - static_cast<float>(q.zero_point));
+			const __m256 high = _mm256_set1_ps(static_cast<float>(std::numeric_limits<U>::max()) - static_cast<float>(q.zero_point));
+			const __m256i zero_point = _mm256_set1_epi32(q.zero_point);
+			if constexpr (sizeof(U) == 1)
+			{
+				// the packs interleave the 128-bit lanes, the permutation puts the elements back in order
+				const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+				for (; i + 32 <= count; i += 32)
+				{
+					const __m256i lo = _mm256_packs_epi32(QuantizeLanes<U>(src + i, scale, low, high, zero_point),
+														  QuantizeLanes<U>(src + i + 8, scale, low, high, zero_point));
+					const __m256i hi = _mm256_packs_epi32(QuantizeLanes<U>(src + i + 16, scale, low, high, zero_point),
+														  QuantizeLanes<U>(src + i + 24, scale, low, high, zero_point));
+					const __m256i bytes = std::is_signed_v<U> ? _mm256_packs_epi16(lo, hi) : _mm256_packus_epi16(lo, hi);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permutevar8x32_epi32(bytes, order));
+				}
+			}
+			else
+			{
+				for (; i + 16 <= count; i += 16)
+				{
+					const __m256i a = QuantizeLanes<U>(src + i, scale, low, high, zero_point);
+					const __m256i b = QuantizeLanes<U>(src + i + 8, scale, low, high, zero_point);
+					const __m256i words = std::is_signed_v<U> ? _mm256_packs_epi32(a, b) : _mm256_packus_epi32(a, b);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_permute4x64_epi64(words, 0xD8));
+				}
+			}
+		}
+		else if constexpr (std::is_same_v<U, float> && IsSmallInteger<T>)
+		{
+			const __m256 scale = _mm256_set1_ps(q.scale);
+			const __m256i zero_point = _mm256_set1_epi32(q.zero_point);
+			for (; i + 8 <= count; i += 8)
+			{
+				const __m256 shifted = _mm256_cvtepi32_ps(_mm256_sub_epi32(WidenLanes(src + i), zero_point));
+				_mm256_storeu_ps(dst + i, _mm256_mul_ps(shifted, scale));
+			}
+		}
+#if defined(__F16C__) || defined(_MSC_VER)
+		else if constexpr (std::is_same_v<T, float> && std::is_same_v<U, half>)
+		{
+			for (; i + 8 <= count; i += 8)
+			{
+				const __m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), halves);
+			}
+		}
+		else if constexpr (std::is_same_v<T, half> && std::is_same_v<U, float>)
+		{
+			for (; i + 8 <= count; i += 8)
+				_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+		}
+#endif
+#endif
+		(void)src, (void)dst, (void)count, (void)q;
+		return i;
+	}
+
+	template<typename U, typename T>
+	inline void ConvertRange(const T* src, U* dst, size_t count, const Quantization& q) noexcept
+	{
+		for (size_t i = ConvertVector(src, dst, count, q); i < count; i++)
+			dst[i] = ConvertOne<U>(src[i], q);
+	}
+}
+
+/*
+ * convert_into(dst, src) - every element of src converted into the element
+ * type of dst, which has the same sizes. Integers are quantized with q (see
+ * ConvertOne), halves and bfloat16s round to nearest even. Large arrays are
+ * converted in parallel chunks.
+ */
+template<typename U, typename T, size_t Dimension>
+void convert_into(DynArray<U, Dimension>& dst, const DynArray<T, Dimension>& src, Quantization q = {})
+{
+	static_assert((std::is_integral_v<U> || ::detail::IsFloating<U>) && (std::is_integral_v<T> || ::detail::IsFloating<T>),
+				  "Only integers, floating points, half and bfloat16 can be converted.");
+	static_assert(sizeof(U) <= 4 || !std::is_integral_v<U> || std::is_integral_v<T>,
+				  "Floating points can only be quantized into integers of up to 32 bits.");
+	for (size_t d = 0; d < Dimension; d++)
+		assert(dst.size(d) == src.size(d));
+	assert(q.scale != 0);
+	const size_t count = src.total_size();
+	const size_t chunks = (count + ::detail::ConvertChunk - 1) / ::detail::ConvertChunk;
+	::detail::ForBlocks(chunks, count, [&](size_t first, size_t last) {
+		const size_t begin = first * ::detail::ConvertChunk, end = std::min(count, last * ::detail::ConvertChunk);
+		::detail::ConvertRange(src.data() + begin, dst.data() + begin, end - begin, q);
+	});
+}
+
+// convert<int8_t>(arr, { scale, zero_point }) - a converted copy of arr
+template<typename U, typename T, size_t Dimension>
+DynArray<U, Dimension> convert(const DynArray<T, Dimension>& arr, Quantization q = {})
+{
+	size_t sizes[Dimension];
+	for (size_t d = 0; d < Dimension; d++)
+		sizes[d] = arr.size(d);
+	auto result = ::detail::MakeDynArray<U, Dimension>(sizes, std::make_index_sequence<Dimension>{});
+	convert_into(result, arr, q);
+	return result;
+}
+
+#endif // DYNARRAY_CONVERT_HEADER_
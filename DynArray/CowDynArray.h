@@ -0,0 +1,236 @@
+﻿#pragma once
+#ifndef DYNARRAY_COW_HEADER_
+#define DYNARRAY_COW_HEADER_
+
+#include "DynArray.h"
+
+#include <atomic>
+#include <algorithm>
+#include <utility>
+#include <cassert>
+#include <cstddef>
+
+// ---------------- detail functions -----------------
+namespace detail {
+	// the elements shared by the copies of a CowDynArray, and how many of them there are
+	template<typename T>
+	struct CowBuffer
+	{
+		explicit CowBuffer(size_t count)
+#ifndef NDEBUG
+			: items(new T[count]{}) // zero initialized
+#else
+			: items(new T[count])
+#endif
+		{}
+		~CowBuffer() noexcept
+		{
+			delete[] items;
+		}
+		CowBuffer(const CowBuffer&) = delete;
+		CowBuffer& operator=(const CowBuffer&) = delete;
+
+		std::atomic<size_t> owners{ 1 };
+		T* items;
+	};
+}
+
+/*
+ * A DynArray whose copies share one reference counted buffer, so a snapshot
+ * costs O(1) whatever the size. The first non-const access (operator[],
+ * data(), ref(), a mutable iterator) of a copy that still shares its buffer
+ * makes it a private deep copy first. As with std::shared_ptr, different
+ * copies can be used from different threads, one copy can't. References
+ * obtained by a non-const access are not tracked: copying the array while
+ * writing through them shares the writes with the new copy.
+ */
+template<typename T, size_t Dimension = 1>
+class CowDynArray
+{
+	static_assert(Dimension != 0, "The dimension of CowDynArray should not be zero.");
+	using Buffer = ::detail::CowBuffer<T>;
+public:
+	CowDynArray() noexcept
+		: dim_info{}, total_count(0), buffer(nullptr)
+	{}
+
+	template<typename... Args>
+	explicit CowDynArray(Args... sizes)
+		: total_count{ ::detail::GetTotalSizeAndFill(dim_info.sizes, sizes...) }
+		, buffer{ ::detail::NullptrAndFillRemains(Dimension, dim_info.remains, dim_info.sizes) }
+	{
+		static_assert(sizeof...(Args) == Dimension,
+					  "The specified Dimension is not equal to the count of sizes args.");
+		static_assert((std::is_convertible_v<Args, size_t> && ...),
+					  "The size types of dimensions must be convertible to size_t.");
+		buffer = new Buffer(total_count);
+	}
+
+	// takes a copy of the elements of arr, which later copies share
+	explicit CowDynArray(const DynArray<T, Dimension>& arr)
+		: total_count(arr.total_size()), buffer(nullptr)
+	{
+		for (size_t d = 0; d < Dimension; d++)
+			dim_info.sizes[d] = arr.size(d);
+		::detail::NullptrAndFillRemains(Dimension, dim_info.remains, dim_info.sizes);
+		if (total_count != 0)
+		{
+			buffer = new Buffer(total_count);
+			std::copy_n(arr.data(), total_count, buffer->items);
+		}
+	}
+
+	~CowDynArray() noexcept
+	{
+		release();
+	}
+
+	CowDynArray(const CowDynArray& other) noexcept
+		: dim_info(other.dim_info), total_count(other.total_count), buffer(other.buffer)
+	{
+		// a new owner comes from an existing one, which keeps the buffer alive meanwhile
+		if (buffer)
+			buffer->owners.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	CowDynArray(CowDynArray&& other) noexcept
+		: dim_info(other.dim_info), total_count(other.total_count), buffer(std::exchange(other.buffer, nullptr))
+	{
+		other.dim_info = {};
+		other.total_count = 0;
+	}
+
+	CowDynArray& operator=(CowDynArray other) & noexcept
+	{
+		this->swap(other);
+		return *this;
+	}
+
+	void swap(CowDynArray& other) noexcept
+	{
+		using std::swap;
+		swap(this->buffer, other.buffer);
+		swap(this->dim_info, other.dim_info);
+		swap(this->total_count, other.total_count);
+	}
+
+	// the copies sharing the buffer, this one included
+	size_t use_count() const noexcept
+	{
+		return buffer ? buffer->owners.load(std::memory_order_acquire) : 0;
+	}
+
+	// makes the buffer private to this copy, which non-const accesses do by themselves
+	void detach()
+	{
+		// acquire: the writes of the owners that left must happen before ours
+		if (!buffer || buffer->owners.load(std::memory_order_acquire) == 1)
+			return;
+		Buffer* own = new Buffer(total_count);
+		std::copy_n(buffer->items, total_count, own->items);
+		release();
+		buffer = own;
+	}
+
+public:
+	DynArrayRef<T, Dimension> ref()
+	{
+		detach();
+		return DynArrayRef<T, Dimension>(items(), dim_info.sizes, dim_info.remains);
+	}
+	DynArrayRef<const T, Dimension> ref() const noexcept
+	{
+		return DynArrayRef<const T, Dimension>(items(), dim_info.sizes, dim_info.remains);
+	}
+	decltype(auto) operator[](size_t index)
+	{
+		return ref()[index];
+	}
+	decltype(auto) operator[](size_t index) const noexcept
+	{
+		return ref()[index];
+	}
+	decltype(auto) front()
+	{
+		return ref()[0];
+	}
+	decltype(auto) front() const noexcept
+	{
+		return ref()[0];
+	}
+	decltype(auto) back()
+	{
+		return ref()[size() - 1];
+	}
+	decltype(auto) back() const noexcept
+	{
+		return ref()[size() - 1];
+	}
+	size_t size(size_t dimension = 0) const noexcept
+	{
+		assert(dimension < Dimension);
+		return dim_info.sizes[dimension];
+	}
+	size_t total_size() const noexcept
+	{
+		return total_count;
+	}
+	T* data()
+	{
+		detach();
+		return items();
+	}
+	const T* data() const noexcept
+	{
+		return items();
+	}
+	DynArrayIterator<T, Dimension> begin()
+	{
+		detach();
+		return DynArrayIterator<T, Dimension>(items(), dim_info.sizes, dim_info.remains);
+	}
+	DynArrayIterator<const T, Dimension> begin() const noexcept
+	{
+		return DynArrayIterator<const T, Dimension>(items(), dim_info.sizes, dim_info.remains);
+	}
+	DynArrayIterator<T, Dimension> end()
+	{
+		detach();
+		return DynArrayIterator<T, Dimension>(items() + total_count, dim_info.sizes, dim_info.remains);
+	}
+	DynArrayIterator<const T, Dimension> end() const noexcept
+	{
+		return DynArrayIterator<const T, Dimension>(items() + total_count, dim_info.sizes, dim_info.remains);
+	}
+	DynArrayFlatIterator<T> iter_all()
+	{
+		detach();
+		return DynArrayFlatIterator<T>(items(), items() + total_count);
+	}
+	DynArrayFlatIterator<const T> iter_all() const noexcept
+	{
+		return DynArrayFlatIterator<const T>(items(), items() + total_count);
+	}
+
+private:
+	T* items() const noexcept
+	{
+		return buffer ? buffer->items : nullptr;
+	}
+	void release() noexcept
+	{
+		// acq_rel: the last owner sees every write of the others before deleting
+		if (buffer && buffer->owners.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			delete buffer;
+		buffer = nullptr;
+	}
+
+	struct { // for assigning conveniently
+		size_t sizes[Dimension];
+		size_t remains[Dimension];
+	}dim_info;
+	size_t total_count;
+	Buffer* buffer;
+};
+
+#endif // DYNARRAY_COW_HEADER_
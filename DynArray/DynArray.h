@@ -7,6 +7,19 @@
 #include <utility>
 #include <cassert>
 #include <cstddef>
+#include <iterator>
+
+// loop hooks, no-ops unless LoopProfiler.h was included first with LOOP_PROFILE
+#ifndef LOOP_PROFILE_HOOKS
+#define LOOP_PROFILE_HOOKS
+#define LOOP_PROFILE_CALLER
+#define LOOP_PROFILE_ONLY_CALLER
+#define LOOP_PROFILE_INIT
+#define LOOP_PROFILE_SITE
+#define LOOP_PROFILE_PROBE
+#define LOOP_PROFILE_START(iterator, kind, where) static_cast<void>(0)
+#define LOOP_PROFILE_STEP(count) static_cast<void>(0)
+#endif
 
 // ------------------- proxy class -------------------
 template<typename T, size_t Dimension>
@@ -96,6 +109,7 @@ class DynArrayIterator
 {
 public:
 	using value_type = T;
+	LOOP_PROFILE_PROBE
 
 public:
 	DynArrayIterator() = default;
@@ -110,6 +124,7 @@ public:
 	DynArrayIterator& operator++() noexcept
 	{
 		arr_data += arr_remain[0];
+		LOOP_PROFILE_STEP(1);
 		return *this;
 	}
 	DynArrayIterator operator++(int) noexcept
@@ -132,6 +147,7 @@ public:
 	DynArrayIterator& operator+=(size_t offset) noexcept
 	{
 		arr_data += arr_remain[0] * offset;
+		LOOP_PROFILE_STEP(offset);
 		return *this;
 	}
 	DynArrayIterator& operator-=(size_t offset) noexcept
@@ -205,6 +221,9 @@ class DynArrayIterator<T, 1>
 {
 public:
 	using value_type = T;
+	using difference_type = ptrdiff_t;
+	using iterator_concept = std::bidirectional_iterator_tag;
+	LOOP_PROFILE_PROBE
 
 public:
 	DynArrayIterator() = default;
@@ -219,6 +238,7 @@ public:
 	DynArrayIterator& operator++() noexcept
 	{
 		++arr_data;
+		LOOP_PROFILE_STEP(1);
 		return *this;
 	}
 	DynArrayIterator operator++(int) noexcept
@@ -241,6 +261,7 @@ public:
 	DynArrayIterator& operator+=(size_t offset) noexcept
 	{
 		arr_data += offset;
+		LOOP_PROFILE_STEP(offset);
 		return *this;
 	}
 	DynArrayIterator& operator-=(size_t offset) noexcept
@@ -309,13 +330,15 @@ public:
 		: arr_begin(begin), arr_end(end)
 	{}
 
-	T* begin() const noexcept
+	DynArrayIterator<T, 1> begin(LOOP_PROFILE_ONLY_CALLER) const noexcept
 	{
-		return arr_begin;
+		DynArrayIterator<T, 1> first(arr_begin, nullptr, nullptr);
+		LOOP_PROFILE_START(first, "iter_all", loop_caller);
+		return first;
 	}
-	T* end() const noexcept
+	DynArrayIterator<T, 1> end() const noexcept
 	{
-		return arr_end;
+		return DynArrayIterator<T, 1>(arr_end, nullptr, nullptr);
 	}
 	size_t size() const noexcept
 	{
@@ -420,7 +443,9 @@ public:
 		this->arr_data = other.arr_data;
 		other.arr_data = nullptr;
 #ifndef NDEBUG
-		other.~DynArray();
+		// not through ~DynArray(), which would end the lifetime of other and drop the stores above
+		other.total_count = 0;
+		other.dim_info = {};
 #endif
 	}
 
@@ -488,13 +513,17 @@ public:
 	{
 		return arr_data;
 	}
-	DynArrayIterator<T, Dimension> begin() noexcept
+	DynArrayIterator<T, Dimension> begin(LOOP_PROFILE_ONLY_CALLER) noexcept
 	{
-		return DynArrayIterator<T, Dimension>(arr_data, dim_info.sizes, dim_info.remains);
+		DynArrayIterator<T, Dimension> first(arr_data, dim_info.sizes, dim_info.remains);
+		LOOP_PROFILE_START(first, "DynArray", loop_caller);
+		return first;
 	}
-	DynArrayIterator<const T, Dimension> begin() const noexcept
+	DynArrayIterator<const T, Dimension> begin(LOOP_PROFILE_ONLY_CALLER) const noexcept
 	{
-		return DynArrayIterator<const T, Dimension>(arr_data, dim_info.sizes, dim_info.remains);
+		DynArrayIterator<const T, Dimension> first(arr_data, dim_info.sizes, dim_info.remains);
+		LOOP_PROFILE_START(first, "DynArray", loop_caller);
+		return first;
 	}
 	DynArrayIterator<T, Dimension> end() noexcept
 	{
@@ -1,8 +1,25 @@
 ﻿#include "DynArray.h"
+#include "Reduce.h"
+#include "MatMul.h"
+#include "Stencil.h"
+#include "CowDynArray.h"
+#include "Convert.h"
+#include "ChunkedDynArray.h"
+#include "Permute.h"
+#include "Sort.h"
 #include <cassert>
+#include <cmath>
+#include <array>
+#include <algorithm>
+#include <thread>
+#include <filesystem>
+#include <vector>
 #include <cstdlib>
+#include <cstdint>
+#include <limits>
 #include <utility>
 #include <ranges>
+#include <random>
 
 int main()
 {
@@ -33,6 +50,21 @@ int main()
 	auto arr3(std::move(arr2));
 	assert(arr3[0][1][2] == 9);
 	assert(arr3[1][3][5] == 54);
+	{
+		// two candidates defeat NRVO, so the result is move constructed and the local destroyed after
+		auto pick = [](bool first) {
+			DynArray<int, 2> a(2, 3), b(3, 2);
+			a[1][2] = 1;
+			b[2][1] = 2;
+			if (first)
+				return a;
+			return b;
+		};
+		auto picked1 = pick(true);
+		auto picked2 = pick(false);
+		assert(picked1.size() == 2 && picked1[1][2] == 1);
+		assert(picked2.size() == 3 && picked2[2][1] == 2);
+	}
 
 	DynArray<int> arr4(5);
 	arr4[0] = 42;
@@ -107,4 +139,407 @@ int main()
 		for (size_t i = 9; auto num:arr.iter_all() | std::views::reverse)
 			assert(num == i--);
 	}
+	{
+		// arr holds 1..120 in memory order
+		auto rows = reduce(arr, 2, std::plus<>{});
+		static_assert(std::is_same_v<decltype(rows), DynArray<int, 2>>);
+		assert(rows.size() == 4 && rows.size(1) == 5);
+		assert(rows[1][3] == 49 + 50 + 51 + 52 + 53 + 54);
+		auto columns = reduce(arr, 1, [](int a, int b) { return std::max(a, b); });
+		assert(columns.size() == 4 && columns.size(1) == 6 && columns[2][1] == 60 + 24 + 2);
+		auto planes = reduce(arr, 0, std::plus<>{});
+		assert(planes[0][0] == 1 + 31 + 61 + 91);
+		assert(reduce(reduce(planes, 1, std::plus<>{}), 0, std::plus<>{}) == 120 * 121 / 2);
+
+		DynArray<float, 2> big(300, 500);
+		for (size_t i = 0; i < big.total_size(); i++)
+			big.data()[i] = static_cast<float>(i % 500);
+		auto sums = reduce(big, 0, std::plus<>{}); // parallel
+		assert(sums[499] == 300 * 499.0F);
+		auto means = broadcast(big, sums, [](float x, float sum) { return x - sum / 300; });
+		assert(means[7][42] == 0.0F);
+
+		DynArray<int, 2> column(3, 1);
+		DynArray<int> row(4);
+		for (size_t i = 0; i < 4; i++)
+			row[i] = static_cast<int>(i);
+		for (size_t i = 0; i < 3; i++)
+			column[i][0] = static_cast<int>(i) * 10;
+		auto table = broadcast(column, row, std::plus<>{});
+		static_assert(std::is_same_v<decltype(table), DynArray<int, 2>>);
+		assert(table.size() == 3 && table.size(1) == 4 && table[2][3] == 23);
+	}
+	{
+		// odd sizes leave partial tiles on every edge
+		DynArray<double, 2> a(37, 300), b(300, 29);
+		for (size_t i = 0; i < a.total_size(); i++)
+			a.data()[i] = static_cast<double>(i % 7) - 3;
+		for (size_t i = 0; i < b.total_size(); i++)
+			b.data()[i] = static_cast<double>(i % 5) - 2;
+		auto c = matmul(a, b);
+		for (size_t i = 0; i < 37; i++)
+		{
+			for (size_t j = 0; j < 29; j++)
+			{
+				double expected = 0;
+				for (size_t p = 0; p < 300; p++)
+					expected += a[i][p] * b[p][j];
+				assert(c[i][j] == expected);
+			}
+		}
+		DynArray<double> x(300), y(37);
+		for (size_t p = 0; p < 300; p++)
+			x[p] = b[p][3];
+		gemv(a, x, y);
+		for (size_t i = 0; i < 37; i++)
+			assert(y[i] == c[i][3]);
+
+		DynArray<int, 2> m(2, 3), n(3, 2);
+		for (int i = 0; i < 6; i++)
+		{
+			m.data()[i] = i + 1;
+			n.data()[i] = 6 - i;
+		}
+		auto mn = matmul(m, n);
+		assert(mn[0][0] == 1 * 6 + 2 * 4 + 3 * 2 && mn[1][1] == 4 * 5 + 5 * 3 + 6 * 1);
+	}
+	{
+		// one step of the 5-point stencil against a direct loop, the edges stay fixed
+		DynArray<double, 2> grid(13, 17), next(13, 17);
+		for (size_t i = 0; i < grid.total_size(); i++)
+			grid.data()[i] = static_cast<double>(i * 7 % 11);
+		apply_stencil<Stencil5>(grid, next, { 0.5, 0.125, 0.125, 0.125, 0.125 });
+		for (size_t i = 0; i < 13; i++)
+		{
+			for (size_t j = 0; j < 17; j++)
+			{
+				const bool edge = i == 0 || j == 0 || i == 12 || j == 16;
+				const double expected = edge ? grid[i][j] : 0.5 * grid[i][j] +
+					0.125 * grid[i - 1][j] + 0.125 * grid[i + 1][j] + 0.125 * grid[i][j - 1] + 0.125 * grid[i][j + 1];
+				assert(next[i][j] == expected);
+			}
+		}
+
+		// blocking in time doesn't change the result, whatever the boundary
+		auto close = [](const auto& lhs, const auto& rhs) {
+			return std::equal(lhs.data(), lhs.data() + lhs.total_size(), rhs.data(),
+							  [](double x, double y) { return std::abs(x - y) <= 1e-12 * std::abs(x); });
+		};
+		for (auto boundary : { Boundary::Fixed, Boundary::Clamp, Boundary::Periodic })
+		{
+			DynArray<double, 2> plain(grid), blocked(grid);
+			iterate_stencil<Stencil5>(plain, 7, { 0.6, 0.1, 0.1, 0.1, 0.1 }, boundary, 1);
+			iterate_stencil<Stencil5>(blocked, 7, { 0.6, 0.1, 0.1, 0.1, 0.1 }, boundary, 3);
+			assert(close(plain, blocked));
+		}
+
+		// the weights of a periodic 27-point average sum to 1, so the total is kept
+		DynArray<double, 3> cube(40, 100, 100); // a few tiles of planes
+		for (size_t i = 0; i < cube.total_size(); i++)
+			cube.data()[i] = static_cast<double>(i % 8);
+		std::array<double, Stencil27::Size> average;
+		average.fill(1.0 / 32);
+		average[13] = 1.0 - 26.0 / 32;
+		static_assert(Stencil27::Radius == 1 && Stencil27::offsets[13] == std::array{ 0, 0, 0 });
+		DynArray<double, 3> box(cube);
+		iterate_stencil<Stencil27>(box, 5, average, Boundary::Periodic, 2);
+		double total = 0;
+		for (size_t i = 0; i < box.total_size(); i++)
+			total += box.data()[i];
+		assert(std::abs(total - 3.5 * cube.total_size()) < 1e-6);
+
+		DynArray<double, 3> heat(cube), reference(cube);
+		const std::array<double, Stencil7::Size> diffuse{ 0.4, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1 };
+		iterate_stencil<Stencil7>(heat, 9, diffuse, Boundary::Clamp, 3);
+		iterate_stencil<Stencil7>(reference, 9, diffuse, Boundary::Clamp, 1);
+		assert(close(heat, reference));
+	}
+	{
+		CowDynArray<int, 2> grid(300, 400);
+		for (auto& cell : grid.iter_all())
+			cell = 1;
+		const CowDynArray<int, 2> snapshot(grid);
+		assert(grid.use_count() == 2 && std::as_const(grid).data() == snapshot.data());
+		grid[1][2] = 5; // the first write makes grid a copy of its own
+		assert(grid.use_count() == 1 && snapshot.use_count() == 1);
+		assert(grid[1][2] == 5 && snapshot[1][2] == 1 && grid.data() != snapshot.data());
+		const int* own = grid.data();
+		grid[0][0] = 2; // already private, no copy this time
+		assert(grid.data() == own);
+
+		// snapshots taken and dropped from many threads at once
+		std::vector<std::thread> readers;
+		std::vector<long long> sums(4);
+		for (size_t t = 0; t < sums.size(); t++)
+		{
+			readers.emplace_back([&, t, copy = snapshot] {
+				for (int round = 0; round < 100; round++)
+				{
+					CowDynArray<int, 2> local(copy);
+					if (round == 99)
+					{
+						for (int cell : std::as_const(local).iter_all())
+							sums[t] += cell;
+					}
+				}
+			});
+		}
+		for (auto& reader : readers)
+			reader.join();
+		for (long long sum : sums)
+			assert(sum == 300 * 400);
+		assert(snapshot.use_count() == 1);
+
+		DynArray<double> plain(3);
+		plain[2] = 1.5;
+		CowDynArray<double> shared(plain), other(shared);
+		for (auto& x : other)
+			x *= 2;
+		assert(shared[2] == 1.5 && other[2] == 3.0 && shared.use_count() == 1);
+		other = std::move(shared);
+		assert(other[2] == 1.5 && other.use_count() == 1);
+	}
+	{
+		// halfway cases round to even, out of range values and NaN saturate
+		DynArray<float> values(6);
+		const float inputs[] = { 1.25F, 1.75F, -1.25F, 1000.0F, -1000.0F, std::numeric_limits<float>::quiet_NaN() };
+		std::copy_n(inputs, 6, values.data());
+		auto bytes = convert<int8_t>(values, { 0.5F, 3 });
+		assert(bytes[0] == 5 && bytes[1] == 7 && bytes[2] == 1 && bytes[3] == 127 && bytes[4] == -128 && bytes[5] == -128);
+		auto back = convert<float>(bytes, { 0.5F, 3 });
+		assert(back[0] == 1.0F && back[1] == 2.0F && back[3] == 62.0F);
+		assert(convert<uint16_t>(values)[1] == 2 && convert<uint16_t>(values)[4] == 0);
+
+		assert(half(1.0F).bits == 0x3C00 && half(65504.0F).bits == 0x7BFF && half(65520.0F).bits == 0x7C00);
+		assert(half(0x1p-25F).bits == 0 && half(0x1.8p-25F).bits == 1 && half(-0x1p-14F).bits == 0x8400);
+		for (uint32_t bits = 0; bits < 0x10000; bits++)
+		{
+			half h;
+			h.bits = static_cast<uint16_t>(bits);
+			const bool nan = (bits & 0x7C00) == 0x7C00 && (bits & 0x3FF) != 0;
+			assert(nan || half(static_cast<float>(h)).bits == bits);
+		}
+		assert(bfloat16(1.00390625F).bits == 0x3F80 && bfloat16(1.01171875F).bits == 0x3F82);
+		assert(static_cast<float>(bfloat16(-2.5F)) == -2.5F);
+
+		// the vector kernels and their tails agree with the element by element conversion
+		DynArray<float, 2> big(301, 513);
+		for (size_t i = 0; i < big.total_size(); i++)
+			big.data()[i] = static_cast<float>(static_cast<int>(i * 7919 % 20011) - 10005) / 37.0F;
+		const Quantization q{ 0.3F, -7 };
+		auto i8 = convert<int8_t>(big, q);
+		auto u8 = convert<uint8_t>(big, q);
+		auto i16 = convert<int16_t>(big, { 0.001F, 100 });
+		auto u16 = convert<uint16_t>(big, q);
+		auto f16 = convert<half>(big);
+		auto b16 = convert<bfloat16>(big);
+		auto f8 = convert<float>(u8, q);
+		auto f16back = convert<float>(f16);
+		for (size_t i = 0; i < big.total_size(); i++)
+		{
+			const float x = big.data()[i];
+			assert(i8.data()[i] == ::detail::ConvertOne<int8_t>(x, q));
+			assert(u8.data()[i] == ::detail::ConvertOne<uint8_t>(x, q));
+			assert(i16.data()[i] == ::detail::ConvertOne<int16_t>(x, { 0.001F, 100 }));
+			assert(u16.data()[i] == ::detail::ConvertOne<uint16_t>(x, q));
+			assert(f16.data()[i].bits == half(x).bits && b16.data()[i].bits == bfloat16(x).bits);
+			assert(f8.data()[i] == (u8.data()[i] + 7) * 0.3F);
+			assert(f16back.data()[i] == static_cast<float>(f16.data()[i]));
+		}
+		DynArray<double, 2> wide(301, 513);
+		convert_into(wide, i16, { 0.001F, 100 });
+		for (size_t i = 0; i < big.total_size(); i++)
+			assert(std::abs(big.data()[i]) > 30 || std::abs(wide.data()[i] - big.data()[i]) <= 0.0005 + 1e-6);
+	}
+	{
+		const auto file = std::filesystem::temp_directory_path() / "dynarray_chunked_test.bin";
+		std::filesystem::remove(file);
+		auto linear = [](size_t i, size_t j, size_t k) { return static_cast<int>((i * 40 + j) * 30 + k); };
+		{
+			// a cache of 6 chunks out of 7 * 5 * 4, the far edges are cut short
+			ChunkedDynArray<int, 3> arr(file, { 50, 40, 30 }, { 8, 8, 8 }, 6, 3);
+			assert(arr.size(2) == 30 && arr.chunks() == 7 && arr.chunks(2) == 4);
+			arr.for_each_chunk([&](const DynArrayChunk<int, 3>& chunk) {
+				for (size_t i = 0; i < chunk.size(0); i++)
+					for (size_t j = 0; j < chunk.size(1); j++)
+						for (size_t k = 0; k < chunk.size(2); k++)
+							chunk[i][j][k] = linear(chunk.origin(0) + i, chunk.origin(1) + j, chunk.origin(2) + k);
+			});
+		}
+		{
+			ChunkedDynArray<int, 3> arr(file, { 50, 40, 30 }, { 8, 8, 8 }, 6, 3);
+			for (size_t i = 0; i < 50; i++)
+				for (size_t j = 0; j < 40; j++)
+					for (size_t k = 0; k < 30; k++)
+						assert(arr[i][j][k] == linear(i, j, k));
+			// backwards across chunks, then writes scattered over the whole file
+			for (size_t i = 50; i-- > 0;)
+				assert(std::as_const(arr)[i][39][29] == linear(i, 39, 29));
+			for (size_t n = 0; n < 1000; n++)
+				arr[n * 7 % 50][n * 13 % 40][n * 17 % 30] = -1;
+			long long slab = 0;
+			std::as_const(arr).for_each_chunk([&](const DynArrayChunk<const int, 3>& chunk) {
+				assert(chunk.origin(0) == 16);
+				slab += chunk.size(0) * chunk.size(1) * chunk.size(2);
+			}, 2, 3);
+			assert(slab == 8 * 40 * 30);
+			assert(arr.good());
+		}
+		{
+			const ChunkedDynArray<int, 3> arr(file, { 50, 40, 30 }, { 8, 8, 8 }, 6, 3);
+			for (size_t n = 0; n < 1000; n++)
+				assert(arr[n * 7 % 50][n * 13 % 40][n * 17 % 30] == -1);
+			assert(arr[1][2][3] == linear(1, 2, 3));
+		}
+		std::filesystem::remove(file);
+		{
+			ChunkedDynArray<double> line(file, { 1000 }, { 64 }, 4, 2);
+			for (size_t i = 0; i < 1000; i++)
+				line[i] = i * 0.5;
+			for (size_t i = 1000; i-- > 0;)
+				assert(line[i] == i * 0.5);
+		}
+		{
+			// a write after flush() marks its chunk again, so evicting the chunk keeps it
+			ChunkedDynArray<double> line(file, { 1000 }, { 64 }, 4, 2);
+			line[5] = 1;
+			line.flush();
+			line[5] = 2;
+			for (size_t i = 64; i < 1000; i += 64)
+				static_cast<void>(std::as_const(line)[i]);
+		}
+		{
+			const ChunkedDynArray<double> line(file, { 1000 }, { 64 }, 4, 2);
+			assert(line[5] == 2);
+		}
+		std::filesystem::remove(file);
+	}
+	{
+		DynArray<int, 3> zyx(37, 64, 129);
+		for (size_t i = 0; i < zyx.total_size(); i++)
+			zyx.data()[i] = static_cast<int>(i);
+		auto xyz = permute_axes<2, 1, 0>(zyx);
+		auto yxz = permute_axes<1, 2, 0>(zyx);
+		assert(xyz.size(0) == 129 && xyz.size(1) == 64 && xyz.size(2) == 37);
+		assert(yxz.size(0) == 64 && yxz.size(1) == 129 && yxz.size(2) == 37);
+		for (size_t z = 0; z < 37; z++)
+		{
+			for (size_t y = 0; y < 64; y++)
+			{
+				for (size_t x = 0; x < 129; x++)
+					assert(xyz[x][y][z] == zyx[z][y][x] && yxz[y][x][z] == zyx[z][y][x]);
+			}
+		}
+		DynArray<int, 3> reused(129, 64, 37);
+		permute_axes<2, 1, 0>(zyx, reused);
+		assert(std::equal(reused.data(), reused.data() + reused.total_size(), xyz.data()));
+		auto same = permute_axes<0, 1, 2>(zyx);
+		assert(std::equal(same.data(), same.data() + same.total_size(), zyx.data()));
+
+		for (size_t n : { 1, 31, 33, 300, 1000 })
+		{
+			DynArray<double, 2> square(n, n);
+			for (size_t i = 0; i < square.total_size(); i++)
+				square.data()[i] = static_cast<double>(i);
+			const double* before = square.data();
+			transpose(square);
+			assert(square.data() == before);
+			for (size_t i = 0; i < n; i++)
+			{
+				for (size_t j = 0; j < n; j++)
+					assert(square[i][j] == static_cast<double>(j * n + i));
+			}
+		}
+		DynArray<int, 2> wide(3, 5);
+		for (size_t i = 0; i < wide.total_size(); i++)
+			wide.data()[i] = static_cast<int>(i);
+		transpose(wide);
+		assert(wide.size() == 5 && wide.size(1) == 3 && wide[4][2] == 14 && wide[1][2] == 11);
+	}
+	{
+		std::mt19937 random(7);
+		// short rows through the network, long ones through radix sort, the middle through std::sort
+		for (size_t n : { 1, 2, 5, 16, 17, 100, 256, 3000 })
+		{
+			DynArray<int, 2> rows(9, n);
+			for (size_t i = 0; i < rows.total_size(); i++)
+				rows.data()[i] = static_cast<int>(random() % 2001) - 1000;
+			DynArray<int, 2> expected = rows;
+			auto order = argsort_along(rows);
+			sort_along(rows);
+			for (size_t r = 0; r < 9; r++)
+			{
+				std::sort(expected[r].data(), expected[r].data() + n);
+				assert(std::equal(rows[r].data(), rows[r].data() + n, expected[r].data()));
+				for (size_t k = 1; k < n; k++)
+					assert(order[r][k - 1] != order[r][k]);
+			}
+		}
+		DynArray<float, 3> cube(30, 20, 10);
+		for (size_t i = 0; i < cube.total_size(); i++)
+			cube.data()[i] = static_cast<float>(random() % 1000) / 10;
+		const DynArray<float, 3> original = cube;
+		auto order = argsort_along(cube, 1);
+		sort_along(cube, 1, std::greater<>{});
+		for (size_t z = 0; z < 30; z++)
+		{
+			for (size_t x = 0; x < 10; x++)
+			{
+				std::vector<float> lane;
+				for (size_t y = 0; y < 20; y++)
+					lane.push_back(original[z][y][x]);
+				std::vector<float> ascending = lane;
+				std::stable_sort(ascending.begin(), ascending.end());
+				for (size_t y = 0; y < 20; y++)
+				{
+					assert(cube[z][y][x] == ascending[19 - y]);
+					assert(lane[order[z][y][x]] == ascending[y]);
+					// ties keep their order
+					assert(y == 0 || lane[order[z][y - 1][x]] != lane[order[z][y][x]] || order[z][y - 1][x] < order[z][y][x]);
+				}
+			}
+		}
+
+		DynArray<long long, 2> columns(1000, 7);
+		for (size_t i = 0; i < columns.total_size(); i++)
+			columns.data()[i] = static_cast<long long>(random()) - (1LL << 31);
+		DynArray<long long, 2> copy = columns;
+		auto stable = argsort_along(columns, 0);
+		sort_along(columns, 0);
+		for (size_t r = 0; r < 1000; r++)
+		{
+			for (size_t c = 0; c < 7; c++)
+				assert(copy[stable[r][c]][c] == columns[r][c]);
+		}
+		nth_element_along(copy, 500, 0);
+		for (size_t c = 0; c < 7; c++)
+		{
+			for (size_t r = 1; r < 1000; r++)
+				assert(columns[r - 1][c] <= columns[r][c]);
+			assert(copy[500][c] == columns[500][c]);
+			for (size_t r = 0; r < 1000; r++)
+				assert(r < 500 ? copy[r][c] <= copy[500][c] : copy[r][c] >= copy[500][c]);
+		}
+
+		DynArray<int> sorted(6), values(8);
+		for (size_t i = 0; i < 6; i++)
+			sorted[i] = static_cast<int>(i / 2 * 10); // 0 0 10 10 20 20
+		const int probes[] = { -5, 0, 5, 10, 15, 20, 25, 10 };
+		std::copy(std::begin(probes), std::end(probes), values.data());
+		auto left = searchsorted(sorted, values), right = searchsorted(sorted, values, true);
+		const size_t lefts[] = { 0, 0, 2, 2, 4, 4, 6, 2 }, rights[] = { 0, 2, 2, 4, 4, 6, 6, 4 };
+		assert(std::equal(left.data(), left.data() + 8, lefts) && std::equal(right.data(), right.data() + 8, rights));
+		DynArray<int, 2> many(4, 5000), queries(4, 300);
+		for (size_t i = 0; i < many.total_size(); i++)
+			many.data()[i] = static_cast<int>(random() % 100000);
+		for (size_t i = 0; i < queries.total_size(); i++)
+			queries.data()[i] = static_cast<int>(random() % 100000);
+		sort_along(many);
+		auto found = searchsorted(many, queries);
+		for (size_t r = 0; r < 4; r++)
+		{
+			for (size_t k = 0; k < 300; k++)
+				assert(found[r][k] == static_cast<size_t>(std::lower_bound(many[r].data(), many[r].data() + 5000, queries[r][k]) - many[r].data()));
+		}
+	}
 }
@@ -0,0 +1,305 @@
+﻿#pragma once
+#ifndef DYNARRAY_MATMUL_HEADER_
+#define DYNARRAY_MATMUL_HEADER_
+
+#include "DynArray.h"
+#include "Reduce.h"
+
+#include <algorithm>
+#include <memory>
+#include <cassert>
+#include <cstddef>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// ---------------- detail functions -----------------
+namespace detail {
+	// a register of Width lanes, the fallback is a plain array the compiler may vectorize itself
+	template<typename T>
+	struct Simd
+	{
+		static constexpr size_t Width = 4;
+		struct Reg { T lanes[Width]; };
+
+		static Reg Zero() noexcept { return Reg{}; }
+		static Reg Broadcast(T value) noexcept
+		{
+			Reg reg;
+			for (size_t i = 0; i < Width; i++)
+				reg.lanes[i] = value;
+			return reg;
+		}
+		static Reg Load(const T* data) noexcept
+		{
+			Reg reg;
+			std::copy_n(data, Width, reg.lanes);
+			return reg;
+		}
+		static void Store(T* data, const Reg& reg) noexcept
+		{
+			std::copy_n(reg.lanes, Width, data);
+		}
+		static Reg Add(Reg a, const Reg& b) noexcept
+		{
+			for (size_t i = 0; i < Width; i++)
+				a.lanes[i] += b.lanes[i];
+			return a;
+		}
+		// a * b + c
+		static Reg Fma(const Reg& a, const Reg& b, Reg c) noexcept
+		{
+			for (size_t i = 0; i < Width; i++)
+				c.lanes[i] += a.lanes[i] * b.lanes[i];
+			return c;
+		}
+	};
+
+#if defined(__AVX512F__)
+	template<>
+	struct Simd<float>
+	{
+		static constexpr size_t Width = 16;
+		using Reg = __m512;
+		static Reg Zero() noexcept { return _mm512_setzero_ps(); }
+		static Reg Broadcast(float value) noexcept { return _mm512_set1_ps(value); }
+		static Reg Load(const float* data) noexcept { return _mm512_loadu_ps(data); }
+		static void Store(float* data, Reg reg) noexcept { _mm512_storeu_ps(data, reg); }
+		static Reg Add(Reg a, Reg b) noexcept { return _mm512_add_ps(a, b); }
+		static Reg Fma(Reg a, Reg b, Reg c) noexcept { return _mm512_fmadd_ps(a, b, c); }
+	};
+
+	template<>
+	struct Simd<double>
+	{
+		static constexpr size_t Width = 8;
+		using Reg = __m512d;
+		static Reg Zero() noexcept { return _mm512_setzero_pd(); }
+		static Reg Broadcast(double value) noexcept { return _mm512_set1_pd(value); }
+		static Reg Load(const double* data) noexcept { return _mm512_loadu_pd(data); }
+		static void Store(double* data, Reg reg) noexcept { _mm512_storeu_pd(data, reg); }
+		static Reg Add(Reg a, Reg b) noexcept { return _mm512_add_pd(a, b); }
+		static Reg Fma(Reg a, Reg b, Reg c) noexcept { return _mm512_fmadd_pd(a, b, c); }
+	};
+#elif defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER)) // /arch:AVX2 implies FMA
+	template<>
+	struct Simd<float>
+	{
+		static constexpr size_t Width = 8;
+		using Reg = __m256;
+		static Reg Zero() noexcept { return _mm256_setzero_ps(); }
+		static Reg Broadcast(float value) noexcept { return _mm256_set1_ps(value); }
+		static Reg Load(const float* data) noexcept { return _mm256_loadu_ps(data); }
+		static void Store(float* data, Reg reg) noexcept { _mm256_storeu_ps(data, reg); }
+		static Reg Add(Reg a, Reg b) noexcept { return _mm256_add_ps(a, b); }
+		static Reg Fma(Reg a, Reg b, Reg c) noexcept { return _mm256_fmadd_ps(a, b, c); }
+	};
+
+	template<>
+	struct Simd<double>
+	{
+		static constexpr size_t Width = 4;
+		using Reg = __m256d;
+		static Reg Zero() noexcept { return _mm256_setzero_pd(); }
+		static Reg Broadcast(double value) noexcept { return _mm256_set1_pd(value); }
+		static Reg Load(const double* data) noexcept { return _mm256_loadu_pd(data); }
+		static void Store(double* data, Reg reg) noexcept { _mm256_storeu_pd(data, reg); }
+		static Reg Add(Reg a, Reg b) noexcept { return _mm256_add_pd(a, b); }
+		static Reg Fma(Reg a, Reg b, Reg c) noexcept { return _mm256_fmadd_pd(a, b, c); }
+	};
+#endif
+
+	/*
+	 * The blocking of C = A * B: B is packed KC x NC at a time, A MC x KC at a
+	 * time, and the micro-kernel keeps an MR x NR tile of C in registers, two
+	 * registers wide, while it walks KC along both packed panels.
+	 */
+	template<typename T>
+	struct GemmBlocking
+	{
+		static constexpr size_t MR = 6;
+		static constexpr size_t NR = 2 * Simd<T>::Width;
+		static constexpr size_t KC = 256;
+		static constexpr size_t MC = MR * 16;
+		static constexpr size_t NC = NR * 128;
+	};
+
+	// rows [0, mc) x columns [0, kc) of A in slivers of MR rows, column by column, padded with zeros
+	template<typename T>
+	void PackA(T* packed, const T* a, size_t lda, size_t mc, size_t kc)
+	{
+		constexpr size_t MR = GemmBlocking<T>::MR;
+		for (size_t i = 0; i < mc; i += MR, packed += MR * kc)
+		{
+			const size_t rows = std::min(MR, mc - i);
+			for (size_t p = 0; p < kc; p++)
+			{
+				for (size_t r = 0; r < MR; r++)
+					packed[p * MR + r] = r < rows ? a[(i + r) * lda + p] : T{};
+			}
+		}
+	}
+
+	// slivers [first, last) of NR columns of B, row by row, padded with zeros
+	template<typename T>
+	void PackB(T* packed, const T* b, size_t ldb, size_t nc, size_t kc, size_t first, size_t last)
+	{
+		constexpr size_t NR = GemmBlocking<T>::NR;
+		for (size_t s = first; s < last; s++)
+		{
+			const size_t cols = std::min(NR, nc - s * NR);
+			T* sliver = packed + s * NR * kc;
+			for (size_t p = 0; p < kc; p++)
+			{
+				const T* row = b + p * ldb + s * NR;
+				std::copy_n(row, cols, sliver + p * NR);
+				std::fill(sliver + p * NR + cols, sliver + (p + 1) * NR, T{});
+			}
+		}
+	}
+
+	// C[rows x cols] += packed A sliver * packed B sliver
+	template<typename T>
+	void MicroKernel(size_t kc, const T* a, const T* b, T* c, size_t ldc, size_t rows, size_t cols)
+	{
+		using V = Simd<T>;
+		constexpr size_t MR = GemmBlocking<T>::MR;
+		constexpr size_t NR = GemmBlocking<T>::NR;
+
+		typename V::Reg acc[MR][2];
+		for (size_t r = 0; r < MR; r++)
+			acc[r][0] = acc[r][1] = V::Zero();
+		for (size_t p = 0; p < kc; p++, a += MR, b += NR)
+		{
+			const auto b0 = V::Load(b);
+			const auto b1 = V::Load(b + V::Width);
+			for (size_t r = 0; r < MR; r++)
+			{
+				const auto ar = V::Broadcast(a[r]);
+				acc[r][0] = V::Fma(ar, b0, acc[r][0]);
+				acc[r][1] = V::Fma(ar, b1, acc[r][1]);
+			}
+		}
+
+		if (rows == MR && cols == NR)
+		{
+			for (size_t r = 0; r < MR; r++)
+			{
+				T* row = c + r * ldc;
+				V::Store(row, V::Add(V::Load(row), acc[r][0]));
+				V::Store(row + V::Width, V::Add(V::Load(row + V::Width), acc[r][1]));
+			}
+		}
+		else // an edge tile goes through memory
+		{
+			T tile[MR][NR];
+			for (size_t r = 0; r < MR; r++)
+			{
+				V::Store(tile[r], acc[r][0]);
+				V::Store(tile[r] + V::Width, acc[r][1]);
+			}
+			for (size_t r = 0; r < rows; r++)
+			{
+				for (size_t j = 0; j < cols; j++)
+					c[r * ldc + j] += tile[r][j];
+			}
+		}
+	}
+
+	template<typename T>
+	T Dot(const T* a, const T* b, size_t count) noexcept
+	{
+		using V = Simd<T>;
+		constexpr size_t Step = V::Width * 4;
+		typename V::Reg acc[4] = { V::Zero(), V::Zero(), V::Zero(), V::Zero() };
+		size_t i = 0;
+		for (; i + Step <= count; i += Step)
+		{
+			for (size_t j = 0; j < 4; j++)
+				acc[j] = V::Fma(V::Load(a + i + j * V::Width), V::Load(b + i + j * V::Width), acc[j]);
+		}
+		T lanes[V::Width];
+		V::Store(lanes, V::Add(V::Add(acc[0], acc[1]), V::Add(acc[2], acc[3])));
+		T result{};
+		for (size_t j = 0; j < V::Width; j++)
+			result += lanes[j];
+		for (; i < count; i++)
+			result += a[i] * b[i];
+		return result;
+	}
+}
+
+/*
+ * matmul(a, b, c) - c = a * b for an M x K matrix a and a K x N matrix b,
+ * with register-blocked micro-kernels over packed, cache-sized panels. The
+ * kernels use AVX-512 or AVX2 for float and double when the build targets
+ * them, plain loops otherwise. The row blocks of a run on the global pool.
+ */
+template<typename T>
+void matmul(const DynArray<T, 2>& a, const DynArray<T, 2>& b, DynArray<T, 2>& c)
+{
+	using Blocking = ::detail::GemmBlocking<T>;
+	constexpr size_t MR = Blocking::MR, NR = Blocking::NR, KC = Blocking::KC, MC = Blocking::MC, NC = Blocking::NC;
+
+	const size_t m = a.size(0), k = a.size(1), n = b.size(1);
+	assert(b.size(0) == k && c.size(0) == m && c.size(1) == n);
+	assert(c.data() != a.data() && c.data() != b.data());
+	std::fill_n(c.data(), m * n, T{});
+
+	std::unique_ptr<T[]> packed_b(new T[KC * NC]);
+	const size_t row_blocks = (m + MC - 1) / MC;
+	for (size_t jc = 0; jc < n; jc += NC)
+	{
+		const size_t nc = std::min(NC, n - jc);
+		const size_t slivers = (nc + NR - 1) / NR;
+		for (size_t pc = 0; pc < k; pc += KC)
+		{
+			const size_t kc = std::min(KC, k - pc);
+			const T* b_block = b.data() + pc * n + jc;
+			::detail::ForBlocks(slivers, kc * nc, [&](size_t first, size_t last) {
+				::detail::PackB(packed_b.get(), b_block, n, nc, kc, first, last);
+			});
+			::detail::ForBlocks(row_blocks, 2 * m * nc * kc, [&](size_t first, size_t last) {
+				std::unique_ptr<T[]> packed_a(new T[MC * KC]);
+				for (size_t block = first; block < last; block++)
+				{
+					const size_t ic = block * MC;
+					const size_t mc = std::min(MC, m - ic);
+					::detail::PackA(packed_a.get(), a.data() + ic * k + pc, k, mc, kc);
+					for (size_t jr = 0; jr < nc; jr += NR)
+					{
+						for (size_t ir = 0; ir < mc; ir += MR)
+						{
+							::detail::MicroKernel(kc, packed_a.get() + ir * kc, packed_b.get() + jr * kc,
+												  c.data() + (ic + ir) * n + jc + jr, n,
+												  std::min(MR, mc - ir), std::min(NR, nc - jr));
+						}
+					}
+				}
+			});
+		}
+	}
+}
+
+template<typename T>
+DynArray<T, 2> matmul(const DynArray<T, 2>& a, const DynArray<T, 2>& b)
+{
+	DynArray<T, 2> c(a.size(0), b.size(1));
+	matmul(a, b, c);
+	return c;
+}
+
+// gemv(a, x, y) - y = a * x, one dot product per row of a, the rows split between threads
+template<typename T>
+void gemv(const DynArray<T, 2>& a, const DynArray<T>& x, DynArray<T>& y)
+{
+	const size_t m = a.size(0), n = a.size(1);
+	assert(x.size() == n && y.size() == m);
+	::detail::ForBlocks(m, m * n, [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++)
+			y[i] = ::detail::Dot(a.data() + i * n, x.data(), n);
+	});
+}
+
+#endif // DYNARRAY_MATMUL_HEADER_
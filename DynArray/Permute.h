@@ -0,0 +1,254 @@
+﻿#pragma once
+#ifndef DYNARRAY_PERMUTE_HEADER_
+#define DYNARRAY_PERMUTE_HEADER_
+
+#include "DynArray.h"
+#include "Reduce.h"
+
+#include <array>
+#include <algorithm>
+#include <utility>
+#include <cassert>
+#include <cstddef>
+
+// ---------------- detail functions -----------------
+namespace detail {
+	// tiles of at most this many elements are copied with plain loops
+	constexpr size_t PermuteTile = 1 << 10;
+	// the side of the square blocks transposed in place through local buffers
+	constexpr size_t TransposeTile = 16;
+
+	template<size_t... Axes>
+	constexpr bool IsPermutation() noexcept
+	{
+		constexpr size_t axes[] = { Axes... };
+		for (size_t d = 0; d < sizeof...(Axes); d++)
+		{
+			if (std::count(std::begin(axes), std::end(axes), d) != 1)
+				return false;
+		}
+		return true;
+	}
+
+	// a tile of rows x columns, the source is contiguous along the rows of dst and dst along its columns
+	template<typename T>
+	inline void TransposeTileCopy(const T* src, size_t src_stride, T* dst, size_t dst_stride,
+								  size_t rows, size_t columns) noexcept
+	{
+		for (size_t i = 0; i < rows; i++)
+		{
+			for (size_t k = 0; k < columns; k++)
+				dst[i * dst_stride + k] = src[i + k * src_stride];
+		}
+	}
+
+	/*
+	 * Copies the box [low, high) of the output. The axes besides the last one
+	 * of the output (Inner) and the one the source is contiguous along are
+	 * split down to single planes first, then the longer side of the plane is
+	 * halved until it fits a tile, so that both the reads and the writes stay
+	 * in cache at every level without knowing its sizes. src_strides are the
+	 * strides of the source along the axes of the output.
+	 */
+	template<typename T, size_t Dimension>
+	void PermuteBox(const T* src, T* dst, const size_t* src_strides, const size_t* dst_strides, size_t contiguous,
+					std::array<size_t, Dimension> low, std::array<size_t, Dimension> high) noexcept
+	{
+		constexpr size_t Inner = Dimension - 1;
+		size_t split = Dimension;
+		for (size_t d = 0; d < Dimension; d++)
+		{
+			if (d != contiguous && d != Inner && high[d] - low[d] > 1 &&
+				(split == Dimension || high[d] - low[d] > high[split] - low[split]))
+				split = d;
+		}
+		if (split == Dimension)
+		{
+			size_t src_offset = 0, dst_offset = 0;
+			for (size_t d = 0; d < Dimension; d++)
+			{
+				src_offset += low[d] * src_strides[d];
+				dst_offset += low[d] * dst_strides[d];
+			}
+			const size_t columns = high[Inner] - low[Inner];
+			if (contiguous == Inner)
+			{
+				std::copy_n(src + src_offset, columns, dst + dst_offset);
+				return;
+			}
+			const size_t rows = high[contiguous] - low[contiguous];
+			if (rows * columns <= PermuteTile)
+			{
+				TransposeTileCopy(src + src_offset, src_strides[Inner], dst + dst_offset, dst_strides[contiguous], rows, columns);
+				return;
+			}
+			split = rows >= columns ? contiguous : Inner;
+		}
+		const size_t middle = low[split] + (high[split] - low[split]) / 2;
+		auto upper = high;
+		upper[split] = middle;
+		PermuteBox<T, Dimension>(src, dst, src_strides, dst_strides, contiguous, low, upper);
+		low[split] = middle;
+		PermuteBox<T, Dimension>(src, dst, src_strides, dst_strides, contiguous, low, high);
+	}
+
+	// swaps two blocks of at most TransposeTile squared elements mirrored over the diagonal, a = b^T
+	template<typename T>
+	inline void SwapTiles(T* a, T* b, size_t stride, size_t rows, size_t columns) noexcept
+	{
+		if constexpr (sizeof(T) <= 16)
+		{
+			// rows x columns at a, columns x rows at b, both read and written row by row
+			T tile_a[TransposeTile * TransposeTile], tile_b[TransposeTile * TransposeTile];
+			for (size_t i = 0; i < rows; i++)
+				std::copy_n(a + i * stride, columns, tile_a + i * columns);
+			for (size_t j = 0; j < columns; j++)
+				std::copy_n(b + j * stride, rows, tile_b + j * rows);
+			for (size_t i = 0; i < rows; i++)
+			{
+				for (size_t j = 0; j < columns; j++)
+					a[i * stride + j] = tile_b[j * rows + i];
+			}
+			for (size_t j = 0; j < columns; j++)
+			{
+				for (size_t i = 0; i < rows; i++)
+					b[j * stride + i] = tile_a[i * columns + j];
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < rows; i++)
+			{
+				for (size_t j = 0; j < columns; j++)
+					std::swap(a[i * stride + j], b[j * stride + i]);
+			}
+		}
+	}
+
+	// swaps the block [row, row + rows) x [column, column + columns) with its mirror over the diagonal
+	template<typename T>
+	void SwapMirror(T* data, size_t stride, size_t row, size_t rows, size_t column, size_t columns) noexcept
+	{
+		if (rows <= TransposeTile && columns <= TransposeTile)
+			SwapTiles(data + row * stride + column, data + column * stride + row, stride, rows, columns);
+		else if (rows >= columns)
+		{
+			SwapMirror(data, stride, row, rows / 2, column, columns);
+			SwapMirror(data, stride, row + rows / 2, rows - rows / 2, column, columns);
+		}
+		else
+		{
+			SwapMirror(data, stride, row, rows, column, columns / 2);
+			SwapMirror(data, stride, row, rows, column + columns / 2, columns - columns / 2);
+		}
+	}
+
+	// transposes the square block on the diagonal starting at first
+	template<typename T>
+	void TransposeDiagonal(T* data, size_t stride, size_t first, size_t size) noexcept
+	{
+		if (size <= TransposeTile)
+		{
+			for (size_t i = first; i < first + size; i++)
+			{
+				for (size_t j = i + 1; j < first + size; j++)
+					std::swap(data[i * stride + j], data[j * stride + i]);
+			}
+			return;
+		}
+		const size_t half = size / 2;
+		TransposeDiagonal(data, stride, first, half);
+		TransposeDiagonal(data, stride, first + half, size - half);
+		SwapMirror(data, stride, first + half, size - half, first, half);
+	}
+}
+
+/*
+ * permute_axes<2, 1, 0>(arr, out) - out = arr with its axes reordered, axis d
+ * of out being axis Axes[d] of arr, as numpy.transpose does. The copy is
+ * cache-oblivious, the longest axis of out is split between the threads of
+ * the global pool.
+ */
+template<size_t... Axes, typename T, size_t Dimension>
+void permute_axes(const DynArray<T, Dimension>& arr, DynArray<T, Dimension>& out)
+{
+	static_assert(sizeof...(Axes) == Dimension, "Every axis must be given once.");
+	static_assert(::detail::IsPermutation<Axes...>(), "The axes must be a permutation of 0 ... Dimension - 1.");
+	constexpr size_t axes[] = { Axes... };
+	assert(arr.data() != out.data());
+
+	size_t src_remains[Dimension];
+	for (size_t d = Dimension, remain = 1; d-- > 0; remain *= arr.size(d))
+		src_remains[d] = remain;
+	size_t sizes[Dimension], src_strides[Dimension], dst_strides[Dimension];
+	for (size_t d = 0; d < Dimension; d++)
+	{
+		sizes[d] = arr.size(axes[d]);
+		src_strides[d] = src_remains[axes[d]];
+		assert(out.size(d) == sizes[d]);
+	}
+	for (size_t d = Dimension, remain = 1; d-- > 0; remain *= sizes[d])
+		dst_strides[d] = remain;
+	// the axis of out the source is contiguous along
+	const size_t contiguous = std::find(axes, axes + Dimension, Dimension - 1) - axes;
+
+	const size_t longest = std::max_element(sizes, sizes + Dimension) - sizes;
+	::detail::ForBlocks(sizes[longest], arr.total_size(), [&](size_t first, size_t last) {
+		std::array<size_t, Dimension> low{}, high;
+		std::copy_n(sizes, Dimension, high.begin());
+		low[longest] = first;
+		high[longest] = last;
+		::detail::PermuteBox<T, Dimension>(arr.data(), out.data(), src_strides, dst_strides, contiguous, low, high);
+	});
+}
+
+// permute_axes<2, 1, 0>(arr) - the same into a new array
+template<size_t... Axes, typename T, size_t Dimension>
+DynArray<T, Dimension> permute_axes(const DynArray<T, Dimension>& arr)
+{
+	constexpr size_t axes[] = { Axes... };
+	size_t sizes[Dimension];
+	for (size_t d = 0; d < Dimension; d++)
+		sizes[d] = arr.size(axes[d]);
+	auto result = ::detail::MakeDynArray<T, Dimension>(sizes, std::make_index_sequence<Dimension>{});
+	permute_axes<Axes...>(arr, result);
+	return result;
+}
+
+/*
+ * transpose(arr) - swaps the two axes of arr. Square arrays are transposed in
+ * place by recursive swaps of mirrored blocks, in parallel bands. Others are
+ * replaced by a permuted copy, as cycles through a rectangle don't stay in
+ * cache.
+ */
+template<typename T>
+void transpose(DynArray<T, 2>& arr)
+{
+	const size_t n = arr.size(0);
+	if (n != arr.size(1))
+	{
+		arr = permute_axes<1, 0>(arr);
+		return;
+	}
+	// bands of rows: one task per diagonal block and per pair of mirrored blocks
+	const size_t bands = std::clamp<size_t>(n / 256, 1, 16);
+	const size_t tasks = bands * (bands + 1) / 2;
+	T* data = arr.data();
+	::detail::ForBlocks(tasks, arr.total_size(), [&](size_t first, size_t last) {
+		for (size_t task = first; task < last; task++)
+		{
+			size_t row = 0, rest = task;
+			while (rest > row)
+				rest -= ++row;
+			const size_t column = rest; // column <= row
+			const size_t row_first = n * row / bands, row_last = n * (row + 1) / bands;
+			const size_t column_first = n * column / bands, column_last = n * (column + 1) / bands;
+			if (row == column)
+				::detail::TransposeDiagonal(data, n, row_first, row_last - row_first);
+			else
+				::detail::SwapMirror(data, n, row_first, row_last - row_first, column_first, column_last - column_first);
+		}
+	});
+}
+
+#endif // DYNARRAY_PERMUTE_HEADER_
@@ -0,0 +1,219 @@
+﻿#pragma once
+#ifndef DYNARRAY_REDUCE_HEADER_
+#define DYNARRAY_REDUCE_HEADER_
+
+#include "DynArray.h"
+#include "../ThreadPool/thread_pool.h"
+
+#include <type_traits>
+#include <functional>
+#include <algorithm>
+#include <utility>
+#include <cassert>
+#include <cstddef>
+#include <atomic>
+
+// ---------------- detail functions -----------------
+namespace detail {
+	// below this many elements a kernel isn't worth splitting between threads
+	constexpr size_t ParallelThreshold = 1 << 16;
+	// elements of a row handled together, small enough to stay in L1 across the reduced axis
+	constexpr size_t ColumnTile = 2048;
+
+	template<typename T, size_t Dimension, size_t... Is>
+	inline DynArray<T, Dimension> MakeDynArray(const size_t* sizes, std::index_sequence<Is...>)
+	{
+		return DynArray<T, Dimension>(sizes[Is]...);
+	}
+
+	// body(first, last) over [0, count), on the global pool when there's enough work
+	template<typename F>
+	inline void ForBlocks(size_t count, size_t work, F&& body)
+	{
+		if (work < ParallelThreshold || count < 2)
+		{
+			body(size_t{ 0 }, count);
+			return;
+		}
+		auto& pool = thread_pool::global();
+		const size_t blocks = std::min(count, pool.size() * 4);
+		// each block is taken by whichever worker is free
+		std::atomic<size_t> next = 0;
+		pool.run([&](size_t) {
+			for (size_t index; (index = next.fetch_add(1, std::memory_order_relaxed)) < blocks; )
+				body(count * index / blocks, count * (index + 1) / blocks);
+		});
+	}
+
+	// a contiguous row folded into several accumulators, so that the loop vectorizes
+	template<typename T, typename Op>
+	inline T ReduceRow(const T* row, size_t count, Op& op)
+	{
+		constexpr size_t Lanes = 8;
+		if (count < Lanes * 2)
+		{
+			T result = row[0];
+			for (size_t i = 1; i < count; i++)
+				result = op(result, row[i]);
+			return result;
+		}
+		T lanes[Lanes];
+		for (size_t j = 0; j < Lanes; j++)
+			lanes[j] = row[j];
+		size_t i = Lanes;
+		for (; i + Lanes <= count; i += Lanes)
+		{
+			for (size_t j = 0; j < Lanes; j++)
+				lanes[j] = op(lanes[j], row[i + j]);
+		}
+		for (; i < count; i++)
+			lanes[i % Lanes] = op(lanes[i % Lanes], row[i]);
+		for (size_t width = Lanes / 2; width > 0; width /= 2)
+		{
+			for (size_t j = 0; j < width; j++)
+				lanes[j] = op(lanes[j], lanes[j + width]);
+		}
+		return lanes[0];
+	}
+
+	// out[i] = op(lhs[i * LhsStep], rhs[i * RhsStep]), the steps are 0 for a broadcast operand
+	template<size_t LhsStep, size_t RhsStep, typename R, typename T, typename U, typename Op>
+	inline void BroadcastRow(R* out, const T* lhs, const U* rhs, size_t count, Op& op)
+	{
+		for (size_t i = 0; i < count; i++)
+			out[i] = op(lhs[i * LhsStep], rhs[i * RhsStep]);
+	}
+}
+
+/*
+ * reduce(arr, axis, op) - folds the given axis with op, e.g. std::plus<>{}
+ * for sums, and returns an array of the remaining axes, or a single value
+ * for a one-dimensional array. The traversal follows memory order whatever
+ * the axis: the innermost axis is folded row by row into several
+ * accumulators, any other axis is folded a tile of contiguous elements at a
+ * time. Large arrays are split between the threads of the global pool.
+ * op must be associative and commutative: rows are folded into 8 interleaved
+ * accumulators that are then combined pairwise, so neither the grouping nor
+ * the order of the elements is kept.
+ */
+template<typename T, size_t Dimension, typename Op>
+auto reduce(const DynArray<T, Dimension>& arr, size_t axis, Op op)
+{
+	assert(axis < Dimension && arr.total_size() != 0);
+	size_t outer = 1, inner = 1;
+	for (size_t d = 0; d < axis; d++)
+		outer *= arr.size(d);
+	for (size_t d = axis + 1; d < Dimension; d++)
+		inner *= arr.size(d);
+	const size_t count = arr.size(axis);
+	const T* in = arr.data();
+
+	if constexpr (Dimension == 1)
+	{
+		return ::detail::ReduceRow(in, count, op);
+	}
+	else
+	{
+		size_t sizes[Dimension - 1];
+		for (size_t d = 0, r = 0; d < Dimension; d++)
+		{
+			if (d != axis)
+				sizes[r++] = arr.size(d);
+		}
+		auto result = ::detail::MakeDynArray<T, Dimension - 1>(sizes, std::make_index_sequence<Dimension - 1>{});
+		T* out = result.data();
+
+		if (inner == 1)
+		{
+			::detail::ForBlocks(outer, arr.total_size(), [&](size_t first, size_t last) {
+				for (size_t o = first; o < last; o++)
+					out[o] = ::detail::ReduceRow(in + o * count, count, op);
+			});
+		}
+		else
+		{
+			const size_t tiles = (inner + ::detail::ColumnTile - 1) / ::detail::ColumnTile;
+			::detail::ForBlocks(outer * tiles, arr.total_size(), [&](size_t first, size_t last) {
+				for (size_t task = first; task < last; task++)
+				{
+					const size_t o = task / tiles;
+					const size_t begin = task % tiles * ::detail::ColumnTile;
+					const size_t width = std::min(::detail::ColumnTile, inner - begin);
+					T* tile = out + o * inner + begin;
+					const T* slice = in + o * count * inner + begin;
+					std::copy_n(slice, width, tile);
+					for (size_t k = 1; k < count; k++)
+					{
+						const T* row = slice + k * inner;
+						for (size_t i = 0; i < width; i++)
+							tile[i] = op(tile[i], row[i]);
+					}
+				}
+			});
+		}
+		return result;
+	}
+}
+
+/*
+ * broadcast(lhs, rhs, op) - applies op element-wise as NumPy does: the
+ * shapes are aligned at their last axes, and an axis of size 1 (or a
+ * missing one) is repeated to match the other operand.
+ */
+template<typename T, size_t LhsDimension, typename U, size_t RhsDimension, typename Op>
+auto broadcast(const DynArray<T, LhsDimension>& lhs, const DynArray<U, RhsDimension>& rhs, Op op)
+{
+	constexpr size_t Dimension = std::max(LhsDimension, RhsDimension);
+	using R = std::decay_t<std::invoke_result_t<Op&, const T&, const U&>>;
+
+	// the size of each operand along every axis of the result, 1 where it has none
+	size_t lhs_sizes[Dimension], rhs_sizes[Dimension], sizes[Dimension];
+	for (size_t d = 0; d < Dimension; d++)
+	{
+		lhs_sizes[d] = d < Dimension - LhsDimension ? 1 : lhs.size(d - (Dimension - LhsDimension));
+		rhs_sizes[d] = d < Dimension - RhsDimension ? 1 : rhs.size(d - (Dimension - RhsDimension));
+		assert(lhs_sizes[d] == rhs_sizes[d] || lhs_sizes[d] == 1 || rhs_sizes[d] == 1);
+		sizes[d] = std::max(lhs_sizes[d], rhs_sizes[d]);
+	}
+	// element strides, 0 along the repeated axes
+	size_t lhs_strides[Dimension], rhs_strides[Dimension];
+	for (size_t d = Dimension, lhs_remain = 1, rhs_remain = 1; d-- > 0; )
+	{
+		lhs_strides[d] = lhs_sizes[d] == 1 ? 0 : lhs_remain;
+		rhs_strides[d] = rhs_sizes[d] == 1 ? 0 : rhs_remain;
+		lhs_remain *= lhs_sizes[d];
+		rhs_remain *= rhs_sizes[d];
+	}
+
+	auto result = ::detail::MakeDynArray<R, Dimension>(sizes, std::make_index_sequence<Dimension>{});
+	if (result.total_size() == 0)
+		return result; // release builds allow empty axes, and then there are no rows
+	R* out = result.data();
+	const size_t inner = sizes[Dimension - 1];
+	::detail::ForBlocks(result.total_size() / inner, result.total_size(), [&](size_t first, size_t last) {
+		for (size_t row = first; row < last; row++)
+		{
+			size_t lhs_offset = 0, rhs_offset = 0;
+			for (size_t d = Dimension - 1, index = row; d-- > 0; index /= sizes[d])
+			{
+				lhs_offset += index % sizes[d] * lhs_strides[d];
+				rhs_offset += index % sizes[d] * rhs_strides[d];
+			}
+			const T* a = lhs.data() + lhs_offset;
+			const U* b = rhs.data() + rhs_offset;
+			R* o = out + row * inner;
+			// a kernel per combination of steps, so that the common ones vectorize
+			if (lhs_strides[Dimension - 1] && rhs_strides[Dimension - 1])
+				::detail::BroadcastRow<1, 1>(o, a, b, inner, op);
+			else if (lhs_strides[Dimension - 1])
+				::detail::BroadcastRow<1, 0>(o, a, b, inner, op);
+			else if (rhs_strides[Dimension - 1])
+				::detail::BroadcastRow<0, 1>(o, a, b, inner, op);
+			else
+				::detail::BroadcastRow<0, 0>(o, a, b, inner, op);
+		}
+	});
+	return result;
+}
+
+#endif // DYNARRAY_REDUCE_HEADER_
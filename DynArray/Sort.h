@@ -0,0 +1,376 @@
+﻿#pragma once
+#ifndef DYNARRAY_SORT_HEADER_
+#define DYNARRAY_SORT_HEADER_
+
+#include "DynArray.h"
+#include "Reduce.h"
+
+#include <array>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cassert>
+#include <cstddef>
+
+// ---------------- detail functions -----------------
+namespace detail {
+	// lanes up to this length are sorted by a network
+	constexpr size_t NetworkLimit = 16;
+	// integer lanes from this length on are radix sorted
+	constexpr size_t RadixThreshold = 256;
+	// short rows sorted together by a network, a vector of them
+	constexpr size_t NetworkRows = 16;
+	// strided lanes gathered together, adjacent in memory so every cache line is read once
+	constexpr size_t LaneBlock = 16;
+	// values searched by one task
+	constexpr size_t SearchChunk = 4096;
+
+	template<typename Compare, typename T>
+	constexpr bool IsNaturalOrder = std::is_arithmetic_v<T> &&
+		(std::is_same_v<Compare, std::less<>> || std::is_same_v<Compare, std::less<T>>);
+	template<typename T>
+	constexpr bool IsRadixKey = std::is_integral_v<T> && !std::is_same_v<T, bool>;
+
+	// the lanes of an axis: outer blocks of count elements apart by inner
+	struct LaneLayout
+	{
+		size_t outer = 1, count = 1, inner = 1;
+	};
+
+	template<typename T, size_t Dimension>
+	inline LaneLayout LanesOf(const DynArray<T, Dimension>& arr, size_t axis) noexcept
+	{
+		assert(axis < Dimension);
+		LaneLayout layout;
+		for (size_t d = 0; d < Dimension; d++)
+			(d < axis ? layout.outer : d == axis ? layout.count : layout.inner) *= arr.size(d);
+		return layout;
+	}
+
+	/*
+	 * fn(lane, o, i) for the lane at outer index o and inner index i, given as
+	 * count contiguous elements and written back. Contiguous lanes are used in
+	 * place, strided ones are gathered LaneBlock at a time into a buffer.
+	 */
+	template<typename T, typename F>
+	void ForLanes(T* data, const LaneLayout& layout, F&& fn)
+	{
+		const auto [outer, count, inner] = layout;
+		if (inner == 1)
+		{
+			::detail::ForBlocks(outer, outer * count, [&](size_t first, size_t last) {
+				for (size_t o = first; o < last; o++)
+					fn(data + o * count, o, size_t{ 0 });
+			});
+			return;
+		}
+		const size_t blocks = (inner + LaneBlock - 1) / LaneBlock;
+		::detail::ForBlocks(outer * blocks, outer * count * inner, [&](size_t first, size_t last) {
+			std::unique_ptr<T[]> buffer(new T[LaneBlock * count]);
+			for (size_t task = first; task < last; task++)
+			{
+				const size_t o = task / blocks, i0 = task % blocks * LaneBlock;
+				const size_t width = std::min(LaneBlock, inner - i0);
+				T* base = data + o * count * inner + i0;
+				for (size_t k = 0; k < count; k++)
+				{
+					for (size_t w = 0; w < width; w++)
+						buffer[w * count + k] = base[k * inner + w];
+				}
+				for (size_t w = 0; w < width; w++)
+					fn(buffer.get() + w * count, o, i0 + w);
+				for (size_t k = 0; k < count; k++)
+				{
+					for (size_t w = 0; w < width; w++)
+						base[k * inner + w] = buffer[w * count + k];
+				}
+			}
+		});
+	}
+
+	// the comparators of Batcher's odd-even merge sort, those past the end are left out as if facing +infinity
+	template<size_t N>
+	constexpr size_t NetworkSize(std::pair<size_t, size_t>* pairs = nullptr) noexcept
+	{
+		size_t size = 0;
+		for (size_t p = 1; p < N; p <<= 1)
+		{
+			for (size_t k = p; k >= 1; k >>= 1)
+			{
+				for (size_t j = k % p; j + k < N; j += 2 * k)
+				{
+					for (size_t i = 0; i < std::min(k, N - j - k); i++)
+					{
+						if ((i + j) / (2 * p) == (i + j + k) / (2 * p))
+						{
+							if (pairs)
+								pairs[size] = { i + j, i + j + k };
+							size++;
+						}
+					}
+				}
+			}
+		}
+		return size;
+	}
+
+	template<size_t N>
+	constexpr auto NetworkPairs = [] {
+		std::array<std::pair<size_t, size_t>, NetworkSize<N>()> pairs{};
+		NetworkSize<N>(pairs.data());
+		return pairs;
+	}();
+
+	/*
+	 * Sorts rows of N contiguous elements, NetworkRows of them at a time: the
+	 * rows are transposed into a local block so that every comparator of the
+	 * unrolled network is a min and a max over a vector of rows.
+	 */
+	template<size_t N, typename T, size_t... Ks>
+	inline void RunNetwork(T* data, size_t rows, std::index_sequence<Ks...>) noexcept
+	{
+		for (size_t first = 0; first < rows; first += NetworkRows)
+		{
+			const size_t width = std::min(NetworkRows, rows - first);
+			T items[N > 0 ? N : 1][NetworkRows];
+			for (size_t r = 0; r < NetworkRows; r++)
+			{
+				for (size_t k = 0; k < N; k++)
+					items[k][r] = data[(first + std::min(r, width - 1)) * N + k];
+			}
+			([&] {
+				T* a = items[NetworkPairs<N>[Ks].first];
+				T* b = items[NetworkPairs<N>[Ks].second];
+				for (size_t r = 0; r < NetworkRows; r++)
+				{
+					const T low = b[r] < a[r] ? b[r] : a[r], high = b[r] < a[r] ? a[r] : b[r];
+					a[r] = low;
+					b[r] = high;
+				}
+			}(), ...);
+			for (size_t r = 0; r < width; r++)
+			{
+				for (size_t k = 0; k < N; k++)
+					data[(first + r) * N + k] = items[k][r];
+			}
+		}
+	}
+
+	template<size_t N, typename T>
+	inline void NetworkSort(T* data, size_t rows) noexcept
+	{
+		RunNetwork<N>(data, rows, std::make_index_sequence<NetworkPairs<N>.size()>{});
+	}
+
+	// rows contiguous rows of count elements each
+	template<typename T, size_t... Ns>
+	inline void SortShort(T* data, size_t count, size_t rows, std::index_sequence<Ns...>) noexcept
+	{
+		using Sorter = void (*)(T*, size_t) noexcept;
+		static constexpr Sorter sorters[] = { &NetworkSort<Ns, T>... };
+		sorters[count](data, rows);
+	}
+
+	// an unsigned key that orders like the integer it comes from
+	template<typename T>
+	inline auto RadixKey(T value) noexcept
+	{
+		using Key = std::make_unsigned_t<T>;
+		if constexpr (std::is_signed_v<T>)
+			return static_cast<Key>(static_cast<Key>(value) ^ (Key{ 1 } << (sizeof(T) * 8 - 1)));
+		else
+			return static_cast<Key>(value);
+	}
+
+	// stable LSD radix sort on key(record), a byte per pass, passes every record agrees on are skipped
+	template<typename R, typename KeyOf>
+	void RadixSort(R* data, R* scratch, size_t count, KeyOf key)
+	{
+		using Key = decltype(key(*data));
+		R* from = data;
+		R* to = scratch;
+		for (size_t shift = 0; shift < sizeof(Key) * 8; shift += 8)
+		{
+			size_t offsets[256] = {};
+			for (size_t i = 0; i < count; i++)
+				offsets[(key(from[i]) >> shift) & 0xFF]++;
+			if (offsets[(key(from[0]) >> shift) & 0xFF] == count)
+				continue;
+			for (size_t digit = 0, sum = 0; digit < 256; digit++)
+				sum += std::exchange(offsets[digit], sum);
+			for (size_t i = 0; i < count; i++)
+				to[offsets[(key(from[i]) >> shift) & 0xFF]++] = from[i];
+			std::swap(from, to);
+		}
+		if (from != data)
+			std::copy_n(from, count, data);
+	}
+
+	template<typename T, typename Compare>
+	void SortLane(T* lane, size_t count, Compare& comp, std::vector<T>& scratch)
+	{
+		if constexpr (IsNaturalOrder<Compare, T>)
+		{
+			if (count <= NetworkLimit)
+				return SortShort(lane, count, 1, std::make_index_sequence<NetworkLimit + 1>{});
+			if constexpr (IsRadixKey<T>)
+			{
+				if (count >= RadixThreshold)
+				{
+					scratch.resize(count);
+					return RadixSort(lane, scratch.data(), count, [](T value) { return RadixKey(value); });
+				}
+			}
+		}
+		std::sort(lane, lane + count, comp);
+	}
+
+	// the first position in [first, first + count) where comp(element, value) fails, without branches
+	template<typename T, typename Compare>
+	inline size_t LowerBound(const T* first, size_t count, const T& value, Compare& comp)
+	{
+		if (count == 0)
+			return 0;
+		const T* base = first;
+		while (count > 1)
+		{
+			const size_t half = count / 2;
+			base = comp(base[half - 1], value) ? base + half : base;
+			count -= half;
+		}
+		return static_cast<size_t>(base - first) + (comp(*base, value) ? 1 : 0);
+	}
+}
+
+/*
+ * sort_along(arr, axis) - sorts every lane of arr along axis on its own, in
+ * parallel. Lanes along the last axis are sorted in place, others through a
+ * buffer. With the natural order, short lanes go through a sorting network
+ * and long integer lanes through a radix sort.
+ */
+template<typename T, size_t Dimension, typename Compare = std::less<>>
+void sort_along(DynArray<T, Dimension>& arr, size_t axis = Dimension - 1, Compare comp = {})
+{
+	const auto layout = ::detail::LanesOf(arr, axis);
+	if constexpr (::detail::IsNaturalOrder<Compare, T>)
+	{
+		if (layout.inner == 1 && layout.count <= ::detail::NetworkLimit)
+		{
+			const size_t groups = (layout.outer + ::detail::NetworkRows - 1) / ::detail::NetworkRows;
+			::detail::ForBlocks(groups, arr.total_size(), [&](size_t first, size_t last) {
+				const size_t rows = std::min(layout.outer, last * ::detail::NetworkRows) - first * ::detail::NetworkRows;
+				::detail::SortShort(arr.data() + first * ::detail::NetworkRows * layout.count, layout.count, rows,
+									std::make_index_sequence<::detail::NetworkLimit + 1>{});
+			});
+			return;
+		}
+	}
+	::detail::ForLanes(arr.data(), layout, [&](T* lane, size_t, size_t) {
+		thread_local std::vector<T> scratch;
+		::detail::SortLane(lane, layout.count, comp, scratch);
+	});
+}
+
+/*
+ * argsort_along(arr, axis) - the indices along axis that would sort every
+ * lane, in an array of the shape of arr. Equal elements keep their order.
+ */
+template<typename T, size_t Dimension, typename Compare = std::less<>>
+DynArray<size_t, Dimension> argsort_along(const DynArray<T, Dimension>& arr, size_t axis = Dimension - 1, Compare comp = {})
+{
+	size_t sizes[Dimension];
+	for (size_t d = 0; d < Dimension; d++)
+		sizes[d] = arr.size(d);
+	auto result = ::detail::MakeDynArray<size_t, Dimension>(sizes, std::make_index_sequence<Dimension>{});
+	const auto layout = ::detail::LanesOf(arr, axis);
+	const size_t count = layout.count, inner = layout.inner;
+	::detail::ForLanes(result.data(), layout, [&](size_t* indices, size_t o, size_t i) {
+		const T* keys = arr.data() + o * count * inner + i;
+		if constexpr (::detail::IsNaturalOrder<Compare, T> && ::detail::IsRadixKey<T>)
+		{
+			if (count >= ::detail::RadixThreshold)
+			{
+				using Record = std::pair<decltype(::detail::RadixKey(T{})), size_t>;
+				thread_local std::vector<Record> records, scratch;
+				records.resize(count);
+				scratch.resize(count);
+				for (size_t k = 0; k < count; k++)
+					records[k] = Record(::detail::RadixKey(keys[k * inner]), k);
+				::detail::RadixSort(records.data(), scratch.data(), count, [](const Record& r) { return r.first; });
+				for (size_t k = 0; k < count; k++)
+					indices[k] = records[k].second;
+				return;
+			}
+		}
+		std::iota(indices, indices + count, size_t{ 0 });
+		std::stable_sort(indices, indices + count, [&](size_t a, size_t b) { return comp(keys[a * inner], keys[b * inner]); });
+	});
+	return result;
+}
+
+/*
+ * nth_element_along(arr, n, axis) - partitions every lane along axis as
+ * std::nth_element does: the n-th element of each lane is the one a sort
+ * would put there, none before it is greater and none after it is less.
+ */
+template<typename T, size_t Dimension, typename Compare = std::less<>>
+void nth_element_along(DynArray<T, Dimension>& arr, size_t n, size_t axis = Dimension - 1, Compare comp = {})
+{
+	const auto layout = ::detail::LanesOf(arr, axis);
+	assert(n < layout.count);
+	::detail::ForLanes(arr.data(), layout, [&](T* lane, size_t, size_t) {
+		std::nth_element(lane, lane + n, lane + layout.count, comp);
+	});
+}
+
+/*
+ * searchsorted(sorted, values) - for every value, the position in the same
+ * row of sorted (the lane along the last axis with the same leading indices)
+ * where it would be inserted to keep the order: before any equal elements,
+ * or after them when right is set, as numpy.searchsorted does. The rows of
+ * sorted must be sorted with comp, the leading sizes of both arrays match.
+ */
+template<typename T, size_t Dimension, typename Compare = std::less<>>
+DynArray<size_t, Dimension> searchsorted(const DynArray<T, Dimension>& sorted, const DynArray<T, Dimension>& values,
+										 bool right = false, Compare comp = {})
+{
+	size_t sizes[Dimension];
+	for (size_t d = 0; d < Dimension; d++)
+	{
+		sizes[d] = values.size(d);
+		assert(d + 1 == Dimension || sizes[d] == sorted.size(d));
+	}
+	auto result = ::detail::MakeDynArray<size_t, Dimension>(sizes, std::make_index_sequence<Dimension>{});
+	const size_t length = sorted.size(Dimension - 1), width = sizes[Dimension - 1];
+	const size_t rows = values.total_size() / width;
+	const size_t chunks = (width + ::detail::SearchChunk - 1) / ::detail::SearchChunk;
+	::detail::ForBlocks(rows * chunks, values.total_size(), [&](size_t first, size_t last) {
+		for (size_t task = first; task < last; task++)
+		{
+			const size_t row = task / chunks, begin = task % chunks * ::detail::SearchChunk;
+			const size_t end = std::min(width, begin + ::detail::SearchChunk);
+			const T* lane = sorted.data() + row * length;
+			const T* items = values.data() + row * width;
+			size_t* out = result.data() + row * width;
+			if (right)
+			{
+				// the first element above the value
+				auto not_above = [&](const T& element, const T& value) { return !comp(value, element); };
+				for (size_t k = begin; k < end; k++)
+					out[k] = ::detail::LowerBound(lane, length, items[k], not_above);
+			}
+			else
+			{
+				for (size_t k = begin; k < end; k++)
+					out[k] = ::detail::LowerBound(lane, length, items[k], comp);
+			}
+		}
+	});
+	return result;
+}
+
+#endif // DYNARRAY_SORT_HEADER_
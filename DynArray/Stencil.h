@@ -0,0 +1,300 @@
+﻿#pragma once
+#ifndef DYNARRAY_STENCIL_HEADER_
+#define DYNARRAY_STENCIL_HEADER_
+
+#include "DynArray.h"
+#include "Reduce.h"
+
+#include <array>
+#include <memory>
+#include <algorithm>
+#include <utility>
+#include <tuple>
+#include <cassert>
+#include <cstddef>
+
+// ------------------ stencil shapes -----------------
+// the offset of a neighbour along every axis, outermost first
+template<int... Offsets>
+struct Point
+{
+	static constexpr std::array<int, sizeof...(Offsets)> offsets{ Offsets... };
+};
+
+template<typename... Points>
+struct Stencil
+{
+	static constexpr size_t Size = sizeof...(Points);
+	static constexpr size_t Dimension = std::tuple_element_t<0, std::tuple<Points...>>::offsets.size();
+	static constexpr std::array<std::array<int, Dimension>, Size> offsets{ Points::offsets... };
+	// how far the farthest neighbour reaches along any axis
+	static constexpr size_t Radius = [] {
+		int radius = 0;
+		for (const auto& point : offsets)
+		{
+			for (int offset : point)
+				radius = std::max(radius, offset < 0 ? -offset : offset);
+		}
+		return static_cast<size_t>(radius);
+	}();
+	static_assert(((Points::offsets.size() == Dimension) && ...), "All points need an offset for every axis.");
+};
+
+namespace detail {
+	template<size_t... Is>
+	Stencil<Point<static_cast<int>(Is / 9) - 1, static_cast<int>(Is / 3 % 3) - 1, static_cast<int>(Is % 3) - 1>...>
+		MakeBoxStencil(std::index_sequence<Is...>);
+}
+
+using Stencil5 = Stencil<Point<0, 0>, Point<-1, 0>, Point<1, 0>, Point<0, -1>, Point<0, 1>>;
+using Stencil7 = Stencil<Point<0, 0, 0>, Point<-1, 0, 0>, Point<1, 0, 0>, Point<0, -1, 0>,
+						 Point<0, 1, 0>, Point<0, 0, -1>, Point<0, 0, 1>>;
+using Stencil27 = decltype(::detail::MakeBoxStencil(std::make_index_sequence<27>{}));
+
+// what the cells within the radius of an edge see outside of the array
+enum struct Boundary
+{
+	Fixed,    // nothing, they keep their values
+	Clamp,    // the nearest cell on the edge
+	Periodic  // the cells on the opposite side
+};
+
+// ---------------- detail functions -----------------
+namespace detail {
+	// the most cells of a row computed by one loop
+	constexpr size_t RowChunk = 256;
+	// the planes of a time blocked tile, about what the L2 cache holds
+	constexpr size_t StencilTileBytes = 1 << 20;
+	// both buffers of an array up to this size stay in the last level cache, time blocking only adds work
+	constexpr size_t StencilCacheBytes = 8 << 20;
+	// the steps of a time block for arrays larger than that
+	constexpr size_t StencilTimeBlock = 4;
+
+	// out[i] = the sum of weights[k] * rows[k][at + i] over the points k, for Count cells
+	template<size_t Count, typename T, size_t... Ks>
+	inline void WeightedRow(T* out, const T* const* rows, size_t at, const T* weights, std::index_sequence<Ks...>) noexcept
+	{
+		// in locals, so that nothing is reloaded inside the loop
+		const T* row[] = { (rows[Ks] + at)... };
+		const T w[] = { weights[Ks]... };
+		for (size_t i = 0; i < Count; i++)
+			out[i] = (... + (w[Ks] * row[Ks][i]));
+	}
+
+	// the cells [begin, end) of a row, Count at a time and then in halves, so that every loop has a fixed length
+	template<size_t Count, size_t Size, typename T>
+	inline void WeightedCells(T* dst, const T* const* rows, size_t begin, size_t end, const T* weights) noexcept
+	{
+		for (; end - begin >= Count; begin += Count)
+		{
+			// through a local buffer, so that the loop vectorises without checking dst against every neighbour
+			T sums[Count];
+			WeightedRow<Count>(sums, rows, begin, weights, std::make_index_sequence<Size>{});
+			std::copy_n(sums, Count, dst + begin);
+		}
+		if constexpr (Count > 1)
+			WeightedCells<Count / 2, Size>(dst, rows, begin, end, weights);
+	}
+
+	// a cell whose neighbours may be outside of the array
+	template<typename S, typename T>
+	T HaloCell(const T* src, const size_t* sizes, const size_t* strides, const size_t* index,
+			   const T* weights, Boundary boundary) noexcept
+	{
+		constexpr size_t Dimension = S::Dimension;
+		size_t center = 0;
+		bool near_edge = false;
+		for (size_t d = 0; d < Dimension; d++)
+		{
+			center += index[d] * strides[d];
+			near_edge |= index[d] < S::Radius || index[d] + S::Radius >= sizes[d];
+		}
+		if (boundary == Boundary::Fixed && near_edge)
+			return src[center];
+
+		// where every offset along every axis lands, mapped once per cell
+		size_t landing[Dimension][2 * S::Radius + 1];
+		for (size_t d = 0; d < Dimension; d++)
+		{
+			const ptrdiff_t size = static_cast<ptrdiff_t>(sizes[d]);
+			for (ptrdiff_t offset = -ptrdiff_t{ S::Radius }; offset <= ptrdiff_t{ S::Radius }; offset++)
+			{
+				ptrdiff_t i = static_cast<ptrdiff_t>(index[d]) + offset;
+				if (i < 0 || i >= size)
+					i = boundary == Boundary::Clamp ? std::clamp<ptrdiff_t>(i, 0, size - 1) : (i % size + size) % size;
+				landing[d][offset + ptrdiff_t{ S::Radius }] = static_cast<size_t>(i) * strides[d];
+			}
+		}
+		T sum{};
+		for (size_t k = 0; k < S::Size; k++)
+		{
+			size_t neighbour = 0;
+			for (size_t d = 0; d < Dimension; d++)
+				neighbour += landing[d][S::offsets[k][d] + static_cast<int>(S::Radius)];
+			sum += weights[k] * src[neighbour];
+		}
+		return sum;
+	}
+
+	/*
+	 * One step from src to dst for the planes [first, last) of the outermost
+	 * axis of an array of the given sizes. A row of the innermost axis away
+	 * from all other edges reads its interior through one pointer per point,
+	 * shifted to the neighbouring row, only the cells near an edge go through
+	 * HaloCell.
+	 */
+	template<typename S, typename T>
+	void SweepPlanes(const T* src, T* dst, const size_t* sizes, size_t first, size_t last,
+					 const T* weights, Boundary boundary) noexcept
+	{
+		constexpr size_t Dimension = S::Dimension;
+		constexpr size_t R = S::Radius;
+		size_t strides[Dimension];
+		for (size_t d = Dimension, remain = 1; d-- > 0; remain *= sizes[d])
+			strides[d] = remain;
+		// local copies, which the stores to dst can't alias
+		ptrdiff_t offsets[S::Size];
+		T w[S::Size];
+		for (size_t k = 0; k < S::Size; k++)
+		{
+			w[k] = weights[k];
+			offsets[k] = 0;
+			for (size_t d = 0; d < Dimension; d++)
+				offsets[k] += S::offsets[k][d] * static_cast<ptrdiff_t>(strides[d]);
+		}
+
+		const size_t inner = sizes[Dimension - 1];
+		const size_t rows_per_plane = Dimension == 1 ? 1 : strides[0] / inner;
+		const T* neighbours[S::Size];
+		for (size_t row = first * rows_per_plane; row < last * rows_per_plane; row++)
+		{
+			size_t index[Dimension] = {};
+			bool interior = inner > 2 * R;
+			for (size_t d = Dimension - 1, rest = row; d-- > 0; rest /= sizes[d])
+			{
+				index[d] = rest % sizes[d];
+				interior &= index[d] >= R && index[d] + R < sizes[d];
+			}
+			const size_t base = row * inner;
+			const size_t begin = interior ? R : inner, end = interior ? inner - R : inner;
+			if (interior)
+			{
+				for (size_t k = 0; k < S::Size; k++)
+					neighbours[k] = src + base + offsets[k];
+				WeightedCells<RowChunk, S::Size>(dst + base, neighbours, begin, end, w);
+			}
+			for (size_t i = 0; i < inner; i = i + 1 == begin ? end : i + 1)
+			{
+				index[Dimension - 1] = i;
+				dst[base + i] = HaloCell<S>(src, sizes, strides, index, weights, boundary);
+			}
+		}
+	}
+}
+
+/*
+ * apply_stencil<Stencil5>(in, out, weights) - out = the weighted sum of the
+ * neighbours given by the stencil, for every cell of in. The outermost axis
+ * is split between the threads of the global pool.
+ */
+template<typename S, typename T, size_t Dimension>
+void apply_stencil(const DynArray<T, Dimension>& in, DynArray<T, Dimension>& out,
+				   const std::array<T, S::Size>& weights, Boundary boundary = Boundary::Fixed)
+{
+	static_assert(S::Dimension == Dimension, "The stencil and the array differ in dimension.");
+	size_t sizes[Dimension];
+	for (size_t d = 0; d < Dimension; d++)
+	{
+		sizes[d] = in.size(d);
+		assert(out.size(d) == sizes[d]);
+	}
+	assert(in.data() != out.data());
+	::detail::ForBlocks(sizes[0], in.total_size() * S::Size, [&](size_t first, size_t last) {
+		::detail::SweepPlanes<S>(in.data(), out.data(), sizes, first, last, weights.data(), boundary);
+	});
+}
+
+/*
+ * iterate_stencil<Stencil7>(arr, steps, weights) - applies the stencil steps
+ * times, swapping arr with a second buffer after every step. With a time
+ * block above 1, the outermost axis is cut into tiles that are advanced
+ * time_block steps at once in a small scratch buffer, each with enough
+ * neighbouring planes to be computed independently, so that an array larger
+ * than the cache is read from memory once per time block instead of once per
+ * step. The tiles run in parallel. By default only arrays larger than the
+ * cache are blocked. Planes too large for a tile to fit in the cache are
+ * always swept one step at a time.
+ */
+template<typename S, typename T, size_t Dimension>
+void iterate_stencil(DynArray<T, Dimension>& arr, size_t steps, const std::array<T, S::Size>& weights,
+					 Boundary boundary = Boundary::Fixed, size_t time_block = 0)
+{
+	static_assert(S::Dimension == Dimension, "The stencil and the array differ in dimension.");
+	constexpr size_t R = S::Radius;
+	size_t sizes[Dimension];
+	for (size_t d = 0; d < Dimension; d++)
+		sizes[d] = arr.size(d);
+	const size_t planes = sizes[0];
+	const size_t plane = arr.total_size() / planes;
+	auto buffer = ::detail::MakeDynArray<T, Dimension>(sizes, std::make_index_sequence<Dimension>{});
+
+	if (time_block == 0)
+		time_block = 2 * arr.total_size() * sizeof(T) > ::detail::StencilCacheBytes ? ::detail::StencilTimeBlock : 1;
+	// a tile needs its ghost planes on both sides, past a few of them it no longer fits the cache
+	if (time_block <= 1 || 4 * time_block * R * plane * sizeof(T) > ::detail::StencilTileBytes)
+	{
+		for (size_t step = 0; step < steps; step++)
+		{
+			apply_stencil<S>(arr, buffer, weights, boundary);
+			arr.swap(buffer);
+		}
+		return;
+	}
+
+	for (size_t done = 0; done < steps; done += time_block)
+	{
+		const size_t block = std::min(time_block, steps - done);
+		const size_t ghost = block * R;
+		const size_t height = std::max(::detail::StencilTileBytes / sizeof(T) / plane, std::max<size_t>(2 * ghost, 1));
+		const size_t tiles = (planes + height - 1) / height;
+		::detail::ForBlocks(tiles, arr.total_size() * S::Size * block, [&](size_t first, size_t last) {
+			const size_t capacity = (height + 2 * ghost) * plane;
+			std::unique_ptr<T[]> scratch(new T[2 * capacity]);
+			for (size_t tile = first; tile < last; tile++)
+			{
+				const size_t low = tile * height, high = std::min(planes, low + height);
+				// the planes the tile depends on, wrapped around or cut at the edges of the array
+				const bool periodic = boundary == Boundary::Periodic;
+				const ptrdiff_t from = periodic ? static_cast<ptrdiff_t>(low) - static_cast<ptrdiff_t>(ghost)
+					: static_cast<ptrdiff_t>(low - std::min(low, ghost));
+				const size_t count = periodic ? high - low + 2 * ghost : std::min(planes, high + ghost) - static_cast<size_t>(from);
+				for (size_t p = 0; p < count; p++)
+				{
+					const ptrdiff_t source = ((from + static_cast<ptrdiff_t>(p)) % static_cast<ptrdiff_t>(planes) +
+											  static_cast<ptrdiff_t>(planes)) % static_cast<ptrdiff_t>(planes);
+					std::copy_n(arr.data() + source * plane, plane, scratch.get() + p * plane);
+				}
+				const bool low_edge = !periodic && from == 0;
+				const bool high_edge = !periodic && static_cast<size_t>(from) + count == planes;
+
+				size_t local[Dimension];
+				std::copy_n(sizes, Dimension, local);
+				local[0] = count;
+				T* src = scratch.get();
+				T* dst = scratch.get() + capacity;
+				for (size_t step = 1; step <= block; step++)
+				{
+					// the planes next to a cut lose their inputs, R more each step
+					::detail::SweepPlanes<S>(src, dst, local, low_edge ? 0 : step * R,
+											 high_edge ? count : count - step * R, weights.data(), boundary);
+					std::swap(src, dst);
+				}
+				const size_t offset = low - static_cast<size_t>(from);
+				std::copy_n(src + offset * plane, (high - low) * plane, buffer.data() + low * plane);
+			}
+		});
+		arr.swap(buffer);
+	}
+}
+
+#endif // DYNARRAY_STENCIL_HEADER_
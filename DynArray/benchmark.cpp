@@ -0,0 +1,255 @@
+﻿#include "DynArray.h"
+#include "MatMul.h"
+#include "Stencil.h"
+#include "Convert.h"
+#include "Permute.h"
+#include "Sort.h"
+
+#include <chrono>
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+/*
+ * Each kernel against the plain loop it replaces:
+ * - matmul and gemv: GFLOP/s against the triple loop over operator[]
+ * - stencils: GFLOP/s against a loop that clamps or wraps every neighbour index,
+ *   time blocked where the array is larger than the cache
+ * - conversions: input GB/s against a scalar loop
+ * - permute_axes and transpose: GB/s read and written against memcpy and strided loops
+ * - sort_along: rows sorted per second against std::sort row by row
+ * Build with /arch:AVX2 (or -mavx2 -mfma, or -march=native) for the vector kernels.
+ */
+
+// benchmarks are built with NDEBUG, so the results are checked without assert
+void Check(bool ok, const char* what)
+{
+	if (!ok)
+	{
+		std::cerr << "check failed: " << what << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+}
+
+template<typename T>
+void NaiveMatMul(const DynArray<T, 2>& a, const DynArray<T, 2>& b, DynArray<T, 2>& c)
+{
+	for (size_t i = 0; i < a.size(0); i++)
+	{
+		for (size_t j = 0; j < b.size(1); j++)
+		{
+			T sum{};
+			for (size_t p = 0; p < a.size(1); p++)
+				sum += a[i][p] * b[p][j];
+			c[i][j] = sum;
+		}
+	}
+}
+
+template<typename T>
+void NaiveGemv(const DynArray<T, 2>& a, const DynArray<T>& x, DynArray<T>& y)
+{
+	for (size_t i = 0; i < a.size(0); i++)
+	{
+		T sum{};
+		for (size_t p = 0; p < a.size(1); p++)
+			sum += a[i][p] * x[p];
+		y[i] = sum;
+	}
+}
+
+template<typename F>
+double Measure(F&& kernel, double flops)
+{
+	kernel(); // warm up the caches and the thread pool
+	size_t rounds = 0;
+	auto start = std::chrono::steady_clock::now();
+	std::chrono::duration<double> elapsed{};
+	do
+	{
+		kernel();
+		rounds++;
+		elapsed = std::chrono::steady_clock::now() - start;
+	} while (elapsed.count() < 0.5);
+	return flops * rounds / elapsed.count() / 1e9; // GFLOP/s
+}
+
+template<typename T>
+void Run(const char* name, size_t size)
+{
+	DynArray<T, 2> a(size, size), b(size, size), c(size, size), expected(size, size);
+	DynArray<T> x(size), y(size), y_expected(size);
+	for (size_t i = 0; i < a.total_size(); i++)
+	{
+		a.data()[i] = static_cast<T>(i % 13) / 13;
+		b.data()[i] = static_cast<T>(i % 7) / 7;
+	}
+	for (size_t i = 0; i < size; i++)
+		x[i] = static_cast<T>(i % 3);
+
+	const double n = static_cast<double>(size);
+	std::cout << name << ' ' << size << ":\tnaive " << Measure([&] { NaiveMatMul(a, b, expected); }, 2 * n * n * n)
+			  << "\tmatmul " << Measure([&] { matmul(a, b, c); }, 2 * n * n * n)
+			  << "\tnaive gemv " << Measure([&] { NaiveGemv(a, x, y_expected); }, 2 * n * n)
+			  << "\tgemv " << Measure([&] { gemv(a, x, y); }, 2 * n * n) << " GFLOP/s\n";
+	for (size_t i = 0; i < c.total_size(); i++)
+		Check(std::abs(c.data()[i] - expected.data()[i]) <= 1e-3 * std::abs(expected.data()[i]) + 1e-3, "matmul matches the triple loop");
+	for (size_t i = 0; i < size; i++)
+		Check(std::abs(y[i] - y_expected[i]) <= 1e-3 * std::abs(y_expected[i]) + 1e-3, "gemv matches the double loop");
+}
+
+// one step of the 5-point stencil with the edge handling inside the loop
+void NaiveStencil5(const DynArray<double, 2>& in, DynArray<double, 2>& out, const std::array<double, 5>& w)
+{
+	const size_t rows = in.size(0), columns = in.size(1);
+	for (size_t i = 0; i < rows; i++)
+	{
+		for (size_t j = 0; j < columns; j++)
+		{
+			out[i][j] = w[0] * in[i][j] + w[1] * in[i == 0 ? 0 : i - 1][j] + w[2] * in[std::min(i + 1, rows - 1)][j] +
+				w[3] * in[i][j == 0 ? 0 : j - 1] + w[4] * in[i][std::min(j + 1, columns - 1)];
+		}
+	}
+}
+
+// one step of the 27-point stencil on a cube with the wrap around inside the loop
+void NaiveStencil27(const DynArray<double, 3>& in, DynArray<double, 3>& out, const std::array<double, 27>& w)
+{
+	const size_t n = in.size(0);
+	for (size_t z = 0; z < n; z++)
+	{
+		for (size_t y = 0; y < n; y++)
+		{
+			for (size_t x = 0; x < n; x++)
+			{
+				double sum = 0;
+				size_t k = 0;
+				for (size_t dz = n - 1; dz <= n + 1; dz++)
+					for (size_t dy = n - 1; dy <= n + 1; dy++)
+						for (size_t dx = n - 1; dx <= n + 1; dx++)
+							sum += w[k++] * in[(z + dz) % n][(y + dy) % n][(x + dx) % n];
+				out[z][y][x] = sum;
+			}
+		}
+	}
+}
+
+void RunStencils(size_t size, size_t steps)
+{
+	const std::array<double, 5> w5{ 0.6, 0.1, 0.1, 0.1, 0.1 };
+	DynArray<double, 2> grid(size, size), next(size, size);
+	for (size_t i = 0; i < grid.total_size(); i++)
+		grid.data()[i] = static_cast<double>(i % 17);
+	const double flops5 = 9.0 * grid.total_size() * steps;
+	std::cout << "5-point " << size << "^2:\tnaive " << Measure([&] {
+		for (size_t step = 0; step < steps; step++)
+		{
+			NaiveStencil5(grid, next, w5);
+			grid.swap(next);
+		}
+	}, flops5) << "\tsweeps " << Measure([&] { iterate_stencil<Stencil5>(grid, steps, w5, Boundary::Clamp, 1); }, flops5)
+			  << "\tblocked " << Measure([&] { iterate_stencil<Stencil5>(grid, steps, w5, Boundary::Clamp, 8); }, flops5)
+			  << " GFLOP/s\n";
+
+	const size_t side = size / 8;
+	std::array<double, Stencil27::Size> w27;
+	w27.fill(1.0 / 27);
+	DynArray<double, 3> cube(side, side, side);
+	for (size_t i = 0; i < cube.total_size(); i++)
+		cube.data()[i] = static_cast<double>(i % 17);
+	const double flops27 = 53.0 * cube.total_size() * steps;
+	DynArray<double, 3> spare(side, side, side);
+	std::cout << "27-point " << side << "^3:\tnaive " << Measure([&] {
+		for (size_t step = 0; step < steps; step++)
+		{
+			NaiveStencil27(cube, spare, w27);
+			cube.swap(spare);
+		}
+	}, flops27) << "\tsweeps " << Measure([&] { iterate_stencil<Stencil27>(cube, steps, w27, Boundary::Periodic, 1); }, flops27)
+			  << " GFLOP/s\n";
+}
+
+void RunConvert(size_t count)
+{
+	DynArray<float> values(count);
+	for (size_t i = 0; i < count; i++)
+		values[i] = static_cast<float>(i % 1000) / 7 - 70;
+	DynArray<int8_t> bytes(count);
+	DynArray<half> halves(count);
+	DynArray<float> back(count);
+	const Quantization q{ 0.5F, 3 };
+	const double gigabytes = count * sizeof(float);
+	std::cout << "convert " << count << ":\tscalar int8 " << Measure([&] {
+		for (size_t i = 0; i < count; i++)
+			bytes[i] = ::detail::ConvertOne<int8_t>(values[i], q);
+	}, gigabytes) << "\tint8 " << Measure([&] { convert_into(bytes, values, q); }, gigabytes)
+			  << "\tscalar half " << Measure([&] {
+		for (size_t i = 0; i < count; i++)
+			halves[i] = half(values[i]);
+	}, gigabytes) << "\thalf " << Measure([&] { convert_into(halves, values); }, gigabytes)
+			  << "\tfrom int8 " << Measure([&] { convert_into(back, bytes, q); }, gigabytes) << " GB/s\n";
+}
+
+void RunPermute(size_t side, size_t square)
+{
+	DynArray<float, 3> zyx(side, side, side), xyz(side, side, side);
+	for (size_t i = 0; i < zyx.total_size(); i++)
+		zyx.data()[i] = static_cast<float>(i);
+	const double moved = 2.0 * zyx.total_size() * sizeof(float);
+	std::cout << "permute " << side << "^3:\tmemcpy " << Measure([&] {
+		std::memcpy(xyz.data(), zyx.data(), zyx.total_size() * sizeof(float));
+	}, moved) << "\tnaive " << Measure([&] {
+		for (size_t z = 0; z < side; z++)
+			for (size_t y = 0; y < side; y++)
+				for (size_t x = 0; x < side; x++)
+					xyz[x][y][z] = zyx[z][y][x];
+	}, moved) << "\tpermute_axes " << Measure([&] { permute_axes<2, 1, 0>(zyx, xyz); }, moved) << " GB/s\n";
+
+	DynArray<float, 2> matrix(square, square);
+	for (size_t i = 0; i < matrix.total_size(); i++)
+		matrix.data()[i] = static_cast<float>(i);
+	const double swapped = 2.0 * matrix.total_size() * sizeof(float);
+	std::cout << "transpose " << square << "^2:\tnaive " << Measure([&] {
+		for (size_t i = 0; i < square; i++)
+			for (size_t j = i + 1; j < square; j++)
+				std::swap(matrix[i][j], matrix[j][i]);
+	}, swapped) << "\tin place " << Measure([&] { transpose(matrix); }, swapped) << " GB/s\n";
+}
+
+void RunSort(size_t rows, size_t columns)
+{
+	DynArray<int, 2> arr(rows, columns), keys(rows, columns);
+	for (size_t i = 0; i < keys.total_size(); i++)
+		keys.data()[i] = static_cast<int>(i * 2654435761u % 1000003);
+	const double millions = static_cast<double>(rows) * 1e3;
+	std::cout << "sort " << rows << 'x' << columns << ":\tstd::sort " << Measure([&] {
+		std::copy_n(keys.data(), keys.total_size(), arr.data());
+		for (size_t r = 0; r < rows; r++)
+			std::sort(arr[r].data(), arr[r].data() + columns);
+	}, millions) << "\tsort_along " << Measure([&] {
+		std::copy_n(keys.data(), keys.total_size(), arr.data());
+		sort_along(arr);
+	}, millions) << " M rows/s\n";
+}
+
+int main()
+{
+	for (size_t columns : { 8, 16, 4096 })
+		RunSort((1 << 22) / columns, columns);
+
+	RunPermute(256, 4096);
+
+	RunConvert(1 << 24);
+
+	for (size_t size : { 512, 2048 })
+		RunStencils(size, 16);
+
+	for (size_t size : { 256, 512, 1024 })
+	{
+		Run<float>("float", size);
+		Run<double>("double", size);
+	}
+}
@@ -0,0 +1,276 @@
+﻿#pragma once
+#ifndef ENCRYPTEDBLOB_HEADER_
+#define ENCRYPTEDBLOB_HEADER_
+
+/*
+ * EncryptedBlob - binary resources encrypted in compile-time, read back in
+ * run-time a chunk at a time, so that the whole plaintext is never in memory.
+ * How to use:
+ *   consteval auto ModelBlob()
+ *   {
+ *       // the plaintext only exists while the constant is evaluated
+ *       constexpr unsigned char data[] = {
+ *       #embed "model.bin"
+ *       };
+ *       return EncryptedBlob(data);
+ *   }
+ *   constexpr auto model = ModelBlob();
+ *   auto reader = model.reader();
+ *   while (size_t count = reader.read(buffer, sizeof(buffer))) ...
+ * Any constexpr array of bytes works in place of #embed. Large blobs may need
+ * a higher constexpr step limit (/constexpr:steps, -fconstexpr-ops-limit).
+ */
+
+#include "EncryptedString.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <source_location>
+#include <span>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace detail {
+	/*
+	 * Lanes xoshiro256** generators side by side, seeded one after the other by
+	 * splitmix64 from the key. Each step yields a block of one word per lane,
+	 * and the lanes don't depend on each other, so a step is a few vector
+	 * operations. The multiplications by 5 and 9 are written as shifts and adds,
+	 * which vectorise without a 64-bit multiply.
+	 */
+	class WideKeystream
+	{
+	public:
+		static constexpr size_t Lanes = 8;
+
+		constexpr explicit WideKeystream(unsigned long long key) noexcept
+		{
+			for (size_t lane = 0; lane < Lanes; lane++)
+			{
+				for (auto& word : state)
+					word[lane] = SplitMix64(key);
+			}
+		}
+		constexpr void operator()(unsigned long long (&block)[Lanes]) noexcept
+		{
+			for (size_t lane = 0; lane < Lanes; lane++)
+			{
+				const unsigned long long times5 = (state[1][lane] << 2) + state[1][lane];
+				const unsigned long long rotated = std::rotl(times5, 7);
+				block[lane] = (rotated << 3) + rotated;
+				const unsigned long long t = state[1][lane] << 17;
+				state[2][lane] ^= state[0][lane];
+				state[3][lane] ^= state[1][lane];
+				state[1][lane] ^= state[2][lane];
+				state[0][lane] ^= state[3][lane];
+				state[2][lane] ^= t;
+				state[3][lane] = std::rotl(state[3][lane], 45);
+			}
+		}
+
+		// out = cipher ^ keystream for blocks whole blocks, the state stays in registers throughout
+		void Xor(const unsigned long long* cipher, unsigned char* out, size_t blocks) noexcept
+		{
+#if defined(__AVX2__)
+			static_assert(Lanes == 8, "The AVX2 kernel steps two vectors of four lanes.");
+			__m256i s[4][2];
+			for (size_t k = 0; k < 4; k++)
+			{
+				for (size_t half = 0; half < 2; half++)
+					s[k][half] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state[k] + half * 4));
+			}
+			for (size_t b = 0; b < blocks; b++)
+			{
+				for (size_t half = 0; half < 2; half++)
+				{
+					const __m256i times5 = _mm256_add_epi64(_mm256_slli_epi64(s[1][half], 2), s[1][half]);
+					const __m256i rotated = _mm256_or_si256(_mm256_slli_epi64(times5, 7), _mm256_srli_epi64(times5, 57));
+					const __m256i result = _mm256_add_epi64(_mm256_slli_epi64(rotated, 3), rotated);
+					const __m256i t = _mm256_slli_epi64(s[1][half], 17);
+					s[2][half] = _mm256_xor_si256(s[2][half], s[0][half]);
+					s[3][half] = _mm256_xor_si256(s[3][half], s[1][half]);
+					s[1][half] = _mm256_xor_si256(s[1][half], s[2][half]);
+					s[0][half] = _mm256_xor_si256(s[0][half], s[3][half]);
+					s[2][half] = _mm256_xor_si256(s[2][half], t);
+					s[3][half] = _mm256_or_si256(_mm256_slli_epi64(s[3][half], 45), _mm256_srli_epi64(s[3][half], 19));
+					const __m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(cipher + b * Lanes + half * 4));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + b * Lanes * 8 + half * 32), _mm256_xor_si256(words, result));
+				}
+			}
+			for (size_t k = 0; k < 4; k++)
+			{
+				for (size_t half = 0; half < 2; half++)
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(state[k] + half * 4), s[k][half]);
+			}
+#else
+			// a local copy, which the stores to out can't alias
+			WideKeystream local = *this;
+			for (size_t b = 0; b < blocks; b++)
+			{
+				unsigned long long plain[Lanes];
+				local(plain);
+				for (size_t lane = 0; lane < Lanes; lane++)
+					plain[lane] = ToLittleEndian(cipher[b * Lanes + lane] ^ plain[lane]);
+				std::memcpy(out + b * Lanes * 8, plain, sizeof(plain));
+			}
+			*this = local;
+			SecureZero(&local, sizeof(local));
+#endif
+		}
+
+	private:
+		unsigned long long state[4][Lanes] = {};
+	};
+}
+
+// decrypts a blob front to back into buffers of the caller
+class EncryptedBlobReader
+{
+public:
+	EncryptedBlobReader(const unsigned long long* cipher, size_t size, unsigned long long seed) noexcept
+		: words(cipher), total(size), key(seed), keystream(seed)
+	{}
+	EncryptedBlobReader(const EncryptedBlobReader&) = default;
+	EncryptedBlobReader& operator=(const EncryptedBlobReader&) = default;
+	~EncryptedBlobReader()
+	{
+		detail::SecureZero(&keystream, sizeof(keystream));
+		detail::SecureZero(block, sizeof(block));
+	}
+
+	// decrypts the next bytes into buffer, as many as fit, returns how many, 0 at the end
+	size_t read(void* buffer, size_t count) noexcept
+	{
+		count = std::min(count, total - position);
+		auto* out = static_cast<unsigned char*>(buffer);
+		size_t done = 0;
+		// the rest of a block started by the last read
+		for (; done < count && position % BlockBytes != 0; done++, position++)
+			out[done] = PlainByte(position);
+		// whole blocks, a keystream step each
+		if (const size_t blocks = (count - done) / BlockBytes; blocks != 0)
+		{
+			keystream.Xor(words + position / 8, out + done, blocks);
+			done += blocks * BlockBytes;
+			position += blocks * BlockBytes;
+		}
+		// the start of the next block, its keystream is kept for the next read
+		if (done < count)
+		{
+			keystream(block);
+			for (; done < count; done++, position++)
+				out[done] = PlainByte(position);
+		}
+		return done;
+	}
+	size_t read(std::span<std::byte> buffer) noexcept
+	{
+		return read(buffer.data(), buffer.size());
+	}
+
+	// start over from the first byte
+	void rewind() noexcept
+	{
+		position = 0;
+		keystream = detail::WideKeystream(key);
+	}
+
+	size_t size() const noexcept
+	{
+		return total;
+	}
+	size_t offset() const noexcept
+	{
+		return position;
+	}
+	size_t remaining() const noexcept
+	{
+		return total - position;
+	}
+
+private:
+	static constexpr size_t Lanes = detail::WideKeystream::Lanes;
+	static constexpr size_t BlockBytes = Lanes * 8;
+
+	unsigned char PlainByte(size_t at) const noexcept
+	{
+		const size_t word = at / 8;
+		return static_cast<unsigned char>((words[word] ^ block[word % Lanes]) >> (at % 8 * 8));
+	}
+
+	const unsigned long long* words;
+	size_t total;
+	unsigned long long key;
+	size_t position = 0;
+	detail::WideKeystream keystream;
+	unsigned long long block[Lanes] = {}; // the keystream of the block holding position
+};
+
+template<size_t N>
+class EncryptedBlob
+{
+	static_assert(N > 0, "An empty blob has nothing to encrypt.");
+
+public:
+	static constexpr size_t Words = (N + 7) / 8;
+
+	// encrypt in compile-time, bytes are packed into little-endian words
+	template<typename TByte>
+		requires (sizeof(TByte) == 1)
+	constexpr EncryptedBlob(const TByte(&data)[N], std::source_location location = std::source_location::current()) noexcept
+		: key(detail::GenerateKey(location, detail::HashString(data, N)))
+	{
+		Encrypt(data);
+	}
+	template<typename TByte>
+		requires (sizeof(TByte) == 1)
+	constexpr EncryptedBlob(const std::array<TByte, N>& data,
+							std::source_location location = std::source_location::current()) noexcept
+		: key(detail::GenerateKey(location, detail::HashString(data.data(), N)))
+	{
+		Encrypt(data);
+	}
+
+	constexpr size_t size() const noexcept
+	{
+		return N;
+	}
+	// decrypt in run-time, chunk by chunk
+	EncryptedBlobReader reader() const noexcept
+	{
+		return EncryptedBlobReader(words, N, key);
+	}
+
+public:
+	// all members stay public so that it can be used as a template argument
+	unsigned long long key;
+	unsigned long long words[Words] = {};
+
+private:
+	template<typename TBytes>
+	constexpr void Encrypt(const TBytes& data) noexcept
+	{
+		for (size_t byte = 0; byte < N; byte++)
+			words[byte / 8] |= static_cast<unsigned long long>(static_cast<unsigned char>(data[byte])) << (byte % 8 * 8);
+		detail::WideKeystream keystream(key);
+		unsigned long long block[detail::WideKeystream::Lanes] = {};
+		for (size_t i = 0; i < Words; i++)
+		{
+			if (i % detail::WideKeystream::Lanes == 0)
+				keystream(block);
+			words[i] ^= block[i % detail::WideKeystream::Lanes];
+		}
+	}
+};
+
+template<typename TByte, size_t N>
+EncryptedBlob(const TByte(&)[N]) -> EncryptedBlob<N>;
+template<typename TByte, size_t N>
+EncryptedBlob(const std::array<TByte, N>&) -> EncryptedBlob<N>;
+
+#endif // ENCRYPTEDBLOB_HEADER_
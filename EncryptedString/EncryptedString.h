@@ -9,9 +9,15 @@
  * Just add suffix [_crypt] to string literal: "a string"_crypt
  */
 
-#include <climits>
 #include <cassert>
+#include <cstring>
+#include <bit>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <type_traits>
+#include <concepts>
+#include <source_location>
 
 #define RANDOM_SEED ((__TIME__[0] - '0') * 1ULL + (__TIME__[1] - '0') * 10ULL + \
 					 (__TIME__[3] - '0') * 60ULL + (__TIME__[4] - '0') * 600ULL + \
@@ -27,25 +33,351 @@ namespace detail {
 	{
 		return LinearCongruentialGenerator((__TIME__[0] - '/') * (__TIME__[1] - '/'));
 	}
-	constexpr unsigned long long GetRandom(unsigned long long min, unsigned long long max)
+	constexpr unsigned long long SplitMix64(unsigned long long& state) noexcept
 	{
-		return min + GenerateRandom() % (max - min + 1);
+		unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
 	}
 	template<typename TChar>
-	constexpr TChar EncryptChar(TChar ch, TChar key)
+	constexpr unsigned long long HashString(const TChar* str, size_t length,
+											unsigned long long hash = 0xCBF29CE484222325ULL) noexcept
 	{
-		return ~(ch ^ key);
+		// FNV-1a over the code units
+		for (size_t i = 0; i < length; i++)
+		{
+			hash ^= static_cast<unsigned long long>(str[i]);
+			hash *= 0x100000001B3ULL;
+		}
+		return hash;
 	}
+	constexpr size_t StringLength(const char* str) noexcept
+	{
+		size_t length = 0;
+		while (str[length] != '\0')
+			length++;
+		return length;
+	}
+	// every literal gets its own key from the build time, its location and its content
+	constexpr unsigned long long GenerateKey(const std::source_location& location,
+											 unsigned long long content_hash) noexcept
+	{
+		unsigned long long state = GenerateRandom();
+		state ^= HashString(location.file_name(), StringLength(location.file_name()));
+		state ^= static_cast<unsigned long long>(location.line()) << 32 | location.column();
+		state ^= content_hash;
+		return SplitMix64(state);
+	}
+
+	// xoshiro256** seeded by splitmix64, yields one 64-bit keystream word per call
+	class Keystream
+	{
+	public:
+		constexpr explicit Keystream(unsigned long long key) noexcept
+		{
+			for (auto& word : state)
+				word = SplitMix64(key);
+		}
+		constexpr unsigned long long operator()() noexcept
+		{
+			const unsigned long long result = Rotl(state[1] * 5, 7) * 9;
+			const unsigned long long t = state[1] << 17;
+			state[2] ^= state[0];
+			state[3] ^= state[1];
+			state[1] ^= state[2];
+			state[0] ^= state[3];
+			state[2] ^= t;
+			state[3] = Rotl(state[3], 45);
+			return result;
+		}
+
+	private:
+		static constexpr unsigned long long Rotl(unsigned long long x, int k) noexcept
+		{
+			return (x << k) | (x >> (64 - k));
+		}
+		unsigned long long state[4] = {};
+	};
+
+	constexpr unsigned long long ToLittleEndian(unsigned long long word) noexcept
+	{
+		if constexpr (std::endian::native == std::endian::big)
+		{
+			unsigned long long swapped = 0;
+			for (int i = 0; i < 8; i++, word >>= 8)
+				swapped = swapped << 8 | (word & 0xFF);
+			return swapped;
+		}
+		else
+			return word;
+	}
+
+	// bit offset of the byte-th byte of a code unit, as laid out in memory
 	template<typename TChar>
-	inline TChar DecryptChar(TChar ch, TChar key) noexcept
+	constexpr size_t UnitShift(size_t byte) noexcept
 	{
-		return ~ch ^ key;
+		const size_t index = byte % sizeof(TChar);
+		return (std::endian::native == std::endian::little ? index : sizeof(TChar) - 1 - index) * 8;
 	}
+
+	// decrypt length code units into out, a whole word per step
 	template<typename TChar>
-	constexpr TChar ObfuscateKey(TChar key, size_t i)
+	inline void DecryptWords(const unsigned long long* words, size_t length,
+							 unsigned long long key, TChar* out) noexcept
 	{
-		return static_cast<TChar>(static_cast<size_t>(key) + i);
+		const size_t bytes = length * sizeof(TChar);
+		auto* dest = reinterpret_cast<unsigned char*>(out);
+		Keystream keystream(key);
+		size_t i = 0;
+		for (; i < bytes / 8; i++)
+		{
+			const auto word = ToLittleEndian(words[i] ^ keystream());
+			std::memcpy(dest + i * 8, &word, 8);
+		}
+		if (bytes % 8 != 0)
+		{
+			const auto word = ToLittleEndian(words[i] ^ keystream());
+			std::memcpy(dest + i * 8, &word, bytes % 8);
+		}
 	}
+
+	template<typename TChar, size_t N>
+	constexpr size_t CipherBytes = (N - 1) * sizeof(TChar); // discard redundant '\0'
+	template<typename TChar, size_t N>
+	constexpr size_t CipherWords = CipherBytes<TChar, N> / 8 + 1; // never zero-sized
+}
+
+namespace detail {
+	inline void SecureZero(void* ptr, size_t size) noexcept
+	{
+#if defined(__GNUC__)
+		std::memset(ptr, 0, size);
+		// make the stores observable so that they aren't dropped as dead
+		__asm__ __volatile__("" : : "r"(ptr) : "memory");
+#else
+		// volatile stores are never elided, as with SecureZeroMemory
+		auto* bytes = static_cast<volatile unsigned char*>(ptr);
+		for (size_t i = 0; i < size; i++)
+			bytes[i] = 0;
+#endif
+	}
+}
+
+/*
+ * secure_basic_string - decrypted text that does not outlive its owner
+ * Its buffer comes from a fixed arena locked in RAM, so it's never swapped out,
+ * and every heap buffer is zeroed when it's released. Text left in the inline
+ * small-string storage when the string grows onto the heap stays there until
+ * wipe() or the destructor, which bring the string back inline and zero that
+ * storage too. Define ENCRYPTED_STRING_SECURE to enable it and make _crypt
+ * return it.
+ */
+#ifdef ENCRYPTED_STRING_SECURE
+#include <mutex>
+#include <new>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif __has_include(<sys/mman.h>)
+#include <sys/mman.h>
+#define ENCRYPTED_STRING_HAS_MLOCK
+#endif
+
+#ifndef ENCRYPTED_STRING_ARENA_SIZE
+#define ENCRYPTED_STRING_ARENA_SIZE (64 * 1024)
+#endif
+
+namespace detail {
+
+	class SecureArena
+	{
+	public:
+		// never destroyed, so that static secure strings can still release their buffers at exit
+		static SecureArena& Instance() noexcept
+		{
+			static SecureArena* arena = new SecureArena;
+			return *arena;
+		}
+
+		void* Allocate(size_t size)
+		{
+			const size_t count = (size + BlockSize - 1) / BlockSize;
+			{
+				std::lock_guard lock(mutex);
+				// first fit over the block bitmap
+				for (size_t first = 0, run = 0; first + run < BlockCount; )
+				{
+					if (IsUsed(first + run))
+					{
+						first += run + 1;
+						run = 0;
+					}
+					else if (++run == count)
+					{
+						for (size_t i = first; i < first + count; i++)
+							used[i / 64] |= 1ULL << (i % 64);
+						return storage + first * BlockSize;
+					}
+				}
+			}
+			// the arena is exhausted, the buffer still gets wiped but isn't locked
+			return ::operator new(size);
+		}
+		void Deallocate(void* ptr, size_t size) noexcept
+		{
+			auto* bytes = static_cast<unsigned char*>(ptr);
+			if (bytes < storage || bytes >= storage + sizeof(storage))
+			{
+				::operator delete(ptr);
+				return;
+			}
+			const size_t first = (bytes - storage) / BlockSize;
+			const size_t count = (size + BlockSize - 1) / BlockSize;
+			std::lock_guard lock(mutex);
+			for (size_t i = first; i < first + count; i++)
+				used[i / 64] &= ~(1ULL << (i % 64));
+		}
+
+	private:
+		static constexpr size_t BlockSize = 64;
+		static constexpr size_t BlockCount = ENCRYPTED_STRING_ARENA_SIZE / BlockSize;
+		static_assert(BlockCount > 0, "ENCRYPTED_STRING_ARENA_SIZE is too small.");
+
+		SecureArena() noexcept
+		{
+			// locking is best effort, it may exceed RLIMIT_MEMLOCK or need privileges
+#if defined(_WIN32)
+			VirtualLock(storage, sizeof(storage));
+#elif defined(ENCRYPTED_STRING_HAS_MLOCK)
+			mlock(storage, sizeof(storage));
+#endif
+		}
+		bool IsUsed(size_t block) const noexcept
+		{
+			return used[block / 64] >> (block % 64) & 1;
+		}
+
+		alignas(4096) unsigned char storage[BlockCount * BlockSize];
+		unsigned long long used[(BlockCount + 63) / 64] = {};
+		std::mutex mutex;
+	};
+
+	template<typename T>
+	struct SecureAllocator
+	{
+		using value_type = T;
+
+		SecureAllocator() = default;
+		template<typename U>
+		constexpr SecureAllocator(const SecureAllocator<U>&) noexcept
+		{}
+
+		[[nodiscard]]
+		T* allocate(size_t count)
+		{
+			return static_cast<T*>(SecureArena::Instance().Allocate(count * sizeof(T)));
+		}
+		void deallocate(T* ptr, size_t count) noexcept
+		{
+			SecureZero(ptr, count * sizeof(T));
+			SecureArena::Instance().Deallocate(ptr, count * sizeof(T));
+		}
+
+		template<typename U>
+		constexpr bool operator==(const SecureAllocator<U>&) const noexcept
+		{
+			return true;
+		}
+	};
+}
+
+template<typename TChar>
+class secure_basic_string
+	: public std::basic_string<TChar, std::char_traits<TChar>, detail::SecureAllocator<TChar>>
+{
+	using Base = std::basic_string<TChar, std::char_traits<TChar>, detail::SecureAllocator<TChar>>;
+public:
+	using Base::Base;
+
+	secure_basic_string() = default;
+	secure_basic_string(const secure_basic_string&) = default;
+	secure_basic_string(secure_basic_string&& other) noexcept
+		: Base(std::move(other))
+	{
+		other.wipe();
+	}
+	~secure_basic_string()
+	{
+		wipe();
+	}
+
+	secure_basic_string& operator=(const secure_basic_string& other)
+	{
+		// a shorter copy would leave the tail of the old text in the reused buffer
+		if (this != &other)
+		{
+			wipe();
+			Base::operator=(other);
+		}
+		return *this;
+	}
+	secure_basic_string& operator=(secure_basic_string&& other) noexcept
+	{
+		wipe();
+		Base::operator=(std::move(other));
+		other.wipe();
+		return *this;
+	}
+
+	// zero the whole buffer, including the unused capacity, and empty the string
+	void wipe() noexcept
+	{
+		detail::SecureZero(this->data(), (this->capacity() + 1) * sizeof(TChar));
+		this->clear();
+		// an empty string moves back to its inline storage, which may still hold older text
+		this->shrink_to_fit();
+		detail::SecureZero(this->data(), (this->capacity() + 1) * sizeof(TChar));
+	}
+
+	// compare in time depending only on the lengths, not on where they differ
+	template<typename String>
+		requires std::convertible_to<const String&, std::basic_string_view<TChar>>
+	friend bool operator==(const secure_basic_string& lhs, const String& rhs) noexcept
+	{
+		const std::basic_string_view<TChar> lhs_view(lhs), rhs_view(rhs);
+		if (lhs_view.size() != rhs_view.size())
+			return false;
+		std::make_unsigned_t<TChar> diff = 0;
+		for (size_t i = 0; i < lhs_view.size(); i++)
+			diff |= static_cast<std::make_unsigned_t<TChar>>(lhs_view[i] ^ rhs_view[i]);
+		return diff == 0;
+	}
+};
+
+using secure_string = secure_basic_string<char>;
+using secure_wstring = secure_basic_string<wchar_t>;
+using secure_u8string = secure_basic_string<char8_t>;
+using secure_u16string = secure_basic_string<char16_t>;
+using secure_u32string = secure_basic_string<char32_t>;
+#endif // ENCRYPTED_STRING_SECURE
+
+namespace detail {
+#ifdef ENCRYPTED_STRING_SECURE
+	template<typename TChar>
+	using CryptString = secure_basic_string<TChar>;
+#define ENCRYPTED_STRING_CONSTEXPR inline
+#else
+	template<typename TChar>
+	using CryptString = std::basic_string<TChar>;
+#define ENCRYPTED_STRING_CONSTEXPR constexpr
+#endif
 }
 
 template<typename TChar, size_t N>
@@ -55,64 +387,173 @@ public:
 	using CharType = TChar;
 
 	// encrypt in compile-time
-	constexpr EncryptedString(const TChar(&origin_str)[N]) noexcept
+	constexpr EncryptedString(const TChar(&origin_str)[N],
+							  std::source_location location = std::source_location::current()) noexcept
+		: key(detail::GenerateKey(location, detail::HashString(origin_str, N)))
 	{
-		for (size_t i = 0; i < N; i++)
+		assert(origin_str[N - 1] == TChar('\0'));
+		// pack code units into little-endian words, then xor them with the keystream
+		for (size_t byte = 0; byte < detail::CipherBytes<TChar, N>; byte++)
 		{
-			str[i] = detail::EncryptChar(origin_str[i], detail::ObfuscateKey(Key, i));
+			const auto unit = static_cast<unsigned long long>(origin_str[byte / sizeof(TChar)]);
+			const auto value = unit >> detail::UnitShift<TChar>(byte) & 0xFF;
+			str[byte / 8] |= value << (byte % 8 * 8);
 		}
+		detail::Keystream keystream(key);
+		for (auto& word : str)
+			word ^= keystream();
 	}
 	// decrypt in run-time
 	[[nodiscard]]
-	operator std::basic_string<TChar>() const
+	operator detail::CryptString<TChar>() const
 	{
-		assert(detail::DecryptChar(str[N - 1], detail::ObfuscateKey(Key, N - 1)) == TChar('\0'));
-		std::basic_string<TChar> decrypted;
-		decrypted.reserve(N - 1);
-		for (size_t i = 0; i < N - 1; i++) // discard redundant '\0'
-		{
-			decrypted += detail::DecryptChar(str[i], detail::ObfuscateKey(Key, i));
-		}
+		detail::CryptString<TChar> decrypted(N - 1, TChar{});
+		detail::DecryptWords(str, N - 1, key, decrypted.data());
 		return decrypted;
 	}
 
 public:
-	TChar str[N] = {};
-private:
-	static constexpr TChar Key =
-		static_cast<TChar>( // casting to signed type is implementation-defined behavior until C++20
-			detail::GetRandom(0x00, (0x01ULL << sizeof(TChar) * CHAR_BIT) - 1)
-		);
+	// all members stay public so that it can be used as a template argument
+	unsigned long long key;
+	unsigned long long str[detail::CipherWords<TChar, N>] = {};
+};
+
+/*
+ * Define ENCRYPTED_STRING_TABLE to collect the ciphertext of all literals into
+ * one contiguous table in a dedicated section instead of a separate object per
+ * literal. Every site then only refers to its record in the table, and all
+ * of them share a single decryption routine per character type. Each literal
+ * still instantiates its own _crypt, as a template literal operator must, but
+ * that instantiation is a single call into the shared routine.
+ * The table is MSVC only: GCC before 14 silently ignores the section of
+ * template entities, so the mode is rejected on other compilers.
+ */
+#if defined(ENCRYPTED_STRING_TABLE) && !defined(NO_ENCRYPTED_STRING)
+#ifndef _MSC_VER
+#error "ENCRYPTED_STRING_TABLE is only supported by MSVC."
+#endif
+#pragma section(".cstr$a", read)
+#pragma section(".cstr$m", read)
+#pragma section(".cstr$z", read)
+#define ENCRYPTED_STRING_SECTION __declspec(allocate(".cstr$m"))
+
+namespace detail {
+	// the part of a record that doesn't depend on its length
+	struct CryptHeader
+	{
+		unsigned long long key = 0;
+		unsigned long long length = 0;
+	};
+
+	template<size_t Words>
+	struct alignas(8) CryptRecord
+	{
+		CryptHeader header;
+		unsigned long long words[Words] = {};
+	};
+
+	template<typename TChar, size_t N>
+	constexpr auto MakeRecord(const EncryptedString<TChar, N>& str) noexcept
+	{
+		CryptRecord<CipherWords<TChar, N>> record;
+		record.header.key = str.key;
+		record.header.length = N - 1;
+		for (size_t i = 0; i < CipherWords<TChar, N>; i++)
+			record.words[i] = str.str[i];
+		return record;
+	}
+
+	template<typename TChar>
+	inline CryptString<TChar> DecryptRecord(const CryptHeader& header, const unsigned long long* words)
+	{
+		CryptString<TChar> decrypted(header.length, TChar{});
+		DecryptWords(words, header.length, header.key, decrypted.data());
+		return decrypted;
+	}
+
+	__declspec(allocate(".cstr$a")) __declspec(selectany)
+		extern const unsigned long long CryptTableBegin = 0;
+	__declspec(allocate(".cstr$z")) __declspec(selectany)
+		extern const unsigned long long CryptTableEnd = 0;
+	inline const unsigned char* CryptTableFirst() noexcept
+	{
+		return reinterpret_cast<const unsigned char*>(&CryptTableBegin + 1);
+	}
+	inline const unsigned char* CryptTableLast() noexcept
+	{
+		return reinterpret_cast<const unsigned char*>(&CryptTableEnd);
+	}
+}
+
+// the table of all encrypted literals linked into the executable
+struct EncryptedStringTable
+{
+	static const unsigned char* begin() noexcept
+	{
+		return detail::CryptTableFirst();
+	}
+	static const unsigned char* end() noexcept
+	{
+		return detail::CryptTableLast();
+	}
+	static size_t size() noexcept
+	{
+		return static_cast<size_t>(end() - begin());
+	}
+	// (offset, length) of a literal whose record starts with header
+	static std::pair<size_t, size_t> locate(const detail::CryptHeader& header) noexcept
+	{
+		auto* ptr = reinterpret_cast<const unsigned char*>(&header);
+		assert(begin() <= ptr && ptr < end());
+		return { static_cast<size_t>(ptr - begin()), static_cast<size_t>(header.length) };
+	}
+	// touch every page of the table, e.g. at startup, to fault it in at once
+	static void prefetch() noexcept
+	{
+		constexpr size_t PageSize = 4096;
+		volatile unsigned char sink = 0;
+		for (auto* ptr = begin(); ptr < end(); ptr += PageSize)
+			sink = sink + *ptr;
+	}
 };
 
-#ifndef NO_ENCRYPTED_STRING
 template<EncryptedString Str>
-inline std::basic_string<typename decltype(Str)::CharType> operator""_crypt() noexcept
+inline detail::CryptString<typename decltype(Str)::CharType> operator""_crypt() noexcept
+{
+	ENCRYPTED_STRING_SECTION static constexpr auto record = detail::MakeRecord(Str);
+	return detail::DecryptRecord<typename decltype(Str)::CharType>(record.header, record.words);
+}
+#elif !defined(NO_ENCRYPTED_STRING)
+template<EncryptedString Str>
+inline detail::CryptString<typename decltype(Str)::CharType> operator""_crypt() noexcept
 {
 	return Str;
 }
 #else
-constexpr std::string operator""_crypt(const char* str, size_t) noexcept
+ENCRYPTED_STRING_CONSTEXPR detail::CryptString<char> operator""_crypt(const char* str, size_t) noexcept
 {
 	return str;
 }
-constexpr std::wstring operator""_crypt(const wchar_t* str, size_t) noexcept
+ENCRYPTED_STRING_CONSTEXPR detail::CryptString<wchar_t> operator""_crypt(const wchar_t* str, size_t) noexcept
 {
 	return str;
 }
-constexpr std::u8string operator""_crypt(const char8_t* str, size_t) noexcept
+ENCRYPTED_STRING_CONSTEXPR detail::CryptString<char8_t> operator""_crypt(const char8_t* str, size_t) noexcept
 {
 	return str;
 }
-constexpr std::u16string operator""_crypt(const char16_t* str, size_t) noexcept
+ENCRYPTED_STRING_CONSTEXPR detail::CryptString<char16_t> operator""_crypt(const char16_t* str, size_t) noexcept
 {
 	return str;
 }
-constexpr std::u32string operator""_crypt(const char32_t* str, size_t) noexcept
+ENCRYPTED_STRING_CONSTEXPR detail::CryptString<char32_t> operator""_crypt(const char32_t* str, size_t) noexcept
 {
 	return str;
 }
 #endif // NO_ENCRYPTED_STRING
 
+#undef ENCRYPTED_STRING_SECTION
+#undef ENCRYPTED_STRING_CONSTEXPR
+#undef ENCRYPTED_STRING_HAS_MLOCK
 #undef RANDOM_SEED
 #endif // ENCRYPTEDSTRING_HEADER_
\ No newline at end of file
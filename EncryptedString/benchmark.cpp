@@ -0,0 +1,171 @@
+﻿#include "EncryptedString.h"
+#include "EncryptedBlob.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+/*
+ * Compares the decryption throughput of the keystream cipher with the former
+ * byte-wise NOT-XOR scheme, which is reproduced below as LegacyString.
+ * For the binary-size overhead, build this file twice, with and without
+ * NO_ENCRYPTED_STRING defined, and compare the size of the executables.
+ * Define ENCRYPTED_STRING_SECURE to measure decryption into the locked arena.
+ * Blobs are read in chunks by EncryptedBlobReader, against decrypting the
+ * same keystream at once a block at a time with its portable scalar step.
+ * Build with /arch:AVX2 (or -mavx2, or -march=native) for the vector reader.
+ */
+
+template<typename TChar, size_t N>
+struct LegacyString
+{
+	static constexpr TChar Key = static_cast<TChar>(0x5A);
+
+	constexpr LegacyString(const TChar(&origin_str)[N]) noexcept
+	{
+		for (size_t i = 0; i < N; i++)
+			str[i] = ~(origin_str[i] ^ static_cast<TChar>(Key + i));
+	}
+	operator std::basic_string<TChar>() const
+	{
+		std::basic_string<TChar> decrypted;
+		decrypted.reserve(N - 1);
+		for (size_t i = 0; i < N - 1; i++)
+			decrypted += ~str[i] ^ static_cast<TChar>(Key + i);
+		return decrypted;
+	}
+
+	TChar str[N] = {};
+};
+
+template<LegacyString Str>
+inline std::string operator""_legacy()
+{
+	return Str;
+}
+
+// benchmarks are built with NDEBUG, so the results are checked without assert
+void Check(bool ok, const char* what)
+{
+	if (!ok)
+	{
+		std::cerr << "check failed: " << what << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+}
+
+template<typename F>
+double Measure(F&& decrypt, size_t length)
+{
+	constexpr size_t Rounds = 1'000'000;
+	size_t checksum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < Rounds; i++)
+		checksum += decrypt().size();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	Check(checksum == Rounds * length, "decrypted length");
+	return Rounds * length / elapsed.count() / (1 << 20); // MiB/s
+}
+
+// a pattern that every byte of a blob can be checked against
+constexpr unsigned char BlobByte(size_t i) noexcept
+{
+	return static_cast<unsigned char>(i * 131 + (i >> 8) * 7);
+}
+
+consteval auto SmallBlob()
+{
+	std::array<unsigned char, 1000> data{};
+	for (size_t i = 0; i < data.size(); i++)
+		data[i] = BlobByte(i);
+	return EncryptedBlob(data);
+}
+
+// the keystream of EncryptedBlobReader, a block at a time through the portable step
+template<size_t N>
+void ScalarDecrypt(const EncryptedBlob<N>& blob, unsigned char* out)
+{
+	constexpr size_t Lanes = detail::WideKeystream::Lanes;
+	detail::WideKeystream keystream(blob.key);
+	unsigned long long block[Lanes];
+	for (size_t i = 0; i < blob.Words; i++)
+	{
+		if (i % Lanes == 0)
+			keystream(block);
+		const unsigned long long word = detail::ToLittleEndian(blob.words[i] ^ block[i % Lanes]);
+		std::memcpy(out + i * 8, &word, std::min<size_t>(8, N - i * 8));
+	}
+}
+
+template<typename F>
+double MeasureStream(F&& decrypt, size_t size)
+{
+	constexpr size_t Rounds = 100;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < Rounds; i++)
+		decrypt();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return Rounds * size / elapsed.count() / (1 << 20); // MiB/s
+}
+
+void RunBlob()
+{
+	// the bytes aren't in the binary, only their ciphertext
+	constexpr auto small = SmallBlob();
+	static_assert(small.size() == 1000);
+	auto reader = small.reader();
+	unsigned char chunk[37];
+	for (size_t offset = 0, count; (count = reader.read(chunk, sizeof(chunk))) != 0; offset += count)
+	{
+		for (size_t i = 0; i < count; i++)
+			Check(chunk[i] == BlobByte(offset + i), "blob chunk");
+	}
+	Check(reader.remaining() == 0 && reader.offset() == 1000, "blob read to the end");
+	reader.rewind();
+	std::vector<unsigned char> all(2000);
+	Check(reader.read(all.data(), all.size()) == 1000 && all[999] == BlobByte(999), "blob rewind");
+
+	// a large blob is built in run-time here, just to measure the reader
+	constexpr size_t Size = 4 << 20;
+	auto plain = std::make_unique<std::array<unsigned char, Size>>();
+	for (size_t i = 0; i < Size; i++)
+		(*plain)[i] = BlobByte(i);
+	auto large = std::make_unique<EncryptedBlob<Size>>(*plain);
+	std::vector<unsigned char> whole(Size);
+	std::vector<std::byte> buffer(64 * 1024);
+	size_t checksum = 0;
+	std::cout << "blob at once, scalar:       " << MeasureStream([&] {
+		ScalarDecrypt(*large, whole.data());
+	}, Size) << " MiB/s\n";
+	Check(std::memcmp(whole.data(), plain->data(), Size) == 0, "large blob, scalar");
+	std::cout << "blob reader, 64 KiB chunks: " << MeasureStream([&] {
+		auto stream = large->reader();
+		while (size_t count = stream.read(buffer))
+			checksum += static_cast<size_t>(buffer[count - 1]);
+	}, Size) << " MiB/s\n";
+	auto stream = large->reader();
+	for (size_t offset = 0, count; (count = stream.read(buffer)) != 0; offset += count)
+		Check(std::memcmp(buffer.data(), plain->data() + offset, count) == 0, "large blob");
+	(void)checksum;
+}
+
+#define TEXT "The quick brown fox jumps over the lazy dog, then keeps running " \
+			 "until the end of a literal that is long enough to leave the SSO."
+
+int main()
+{
+	constexpr size_t Length = sizeof(TEXT) - 1;
+	Check(TEXT ""_crypt == TEXT, "_crypt round trip");
+	Check(TEXT ""_legacy == TEXT, "_legacy round trip");
+
+	std::cout << "legacy:    " << Measure([] { return TEXT ""_legacy; }, Length) << " MiB/s\n";
+	std::cout << "keystream: " << Measure([] { return TEXT ""_crypt; }, Length) << " MiB/s\n";
+	std::cout << "storage per literal: legacy " << sizeof(LegacyString<char, sizeof(TEXT)>)
+			  << " bytes, keystream " << sizeof(EncryptedString<char, sizeof(TEXT)>) << " bytes\n";
+
+	RunBlob();
+}
@@ -0,0 +1,312 @@
+﻿#pragma once
+#ifndef LOOP_PROFILER_HEADER_
+#define LOOP_PROFILER_HEADER_
+
+/*
+ * Define LOOP_PROFILE and include this header before range.h, enumerate.h or
+ * DynArray.h to record every loop over range, enumerate, the rows of a
+ * DynArray and its iter_all() with the place it was written at, its iteration
+ * count and the TSC cycles it took. The iterator returned by begin() times the loop until it's
+ * destroyed and counts its own steps, so copies of it and helpers that never
+ * step, like front(), empty() or operator[], aren't recorded.
+ * Those headers define the hooks as no-ops when they come first, so without
+ * LOOP_PROFILE they don't depend on this header and nothing is recorded.
+ */
+#ifdef LOOP_PROFILE
+
+#ifdef LOOP_PROFILE_HOOKS
+#error "Include LoopProfiler.h before the headers it instruments."
+#endif
+#define LOOP_PROFILE_HOOKS
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <source_location>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// records kept per thread, later ones are dropped and counted
+#ifndef LOOP_PROFILE_CAPACITY
+#define LOOP_PROFILE_CAPACITY 65536
+#endif
+
+namespace LoopProfiler
+{
+	struct Record
+	{
+		size_t thread; // numbered in the order they first record a loop
+		const char* kind;
+		std::source_location where;
+		uint64_t start; // in ticks
+		uint64_t cycles;
+		uint64_t iterations;
+	};
+
+	namespace detail
+	{
+		inline uint64_t Ticks() noexcept
+		{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+#else
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+		}
+
+		// written by the thread owning it only, count publishes the records to the reporter
+		struct ThreadLog
+		{
+			Record records[LOOP_PROFILE_CAPACITY];
+			std::atomic<size_t> count = 0;
+			std::atomic<uint64_t> dropped = 0;
+			std::atomic<bool> owned = true;
+			ThreadLog* next = nullptr;
+		};
+
+		struct Registry
+		{
+			std::atomic<ThreadLog*> logs = nullptr;
+			std::atomic<size_t> threads = 0;
+			const uint64_t epoch_ticks = Ticks();
+			const std::chrono::steady_clock::time_point epoch_time = std::chrono::steady_clock::now();
+
+			static Registry& Instance()
+			{
+				static Registry registry;
+				return registry;
+			}
+		};
+
+		// kept until exit so that the loops of a thread can be reported after it has
+		// exited, and handed on to the next new thread, so there's one per running thread
+		struct ThreadHandle
+		{
+			ThreadLog* log;
+			size_t thread;
+
+			ThreadHandle()
+			{
+				auto& registry = Registry::Instance();
+				thread = registry.threads.fetch_add(1, std::memory_order_relaxed);
+				for (log = registry.logs.load(std::memory_order_acquire); log; log = log->next)
+					if (!log->owned.load(std::memory_order_relaxed) && !log->owned.exchange(true, std::memory_order_acquire))
+						return;
+				log = new ThreadLog;
+				log->next = registry.logs.load(std::memory_order_relaxed);
+				while (!registry.logs.compare_exchange_weak(log->next, log,
+															std::memory_order_release, std::memory_order_relaxed))
+					;
+			}
+			~ThreadHandle()
+			{
+				log->owned.store(false, std::memory_order_release);
+			}
+		};
+
+		inline ThreadHandle& Handle()
+		{
+			thread_local ThreadHandle handle;
+			return handle;
+		}
+
+		inline void Append(Record record) noexcept
+		{
+			ThreadHandle& handle = Handle();
+			ThreadLog& log = *handle.log;
+			record.thread = handle.thread;
+			const size_t count = log.count.load(std::memory_order_relaxed);
+			if (count == LOOP_PROFILE_CAPACITY)
+			{
+				log.dropped.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			log.records[count] = record;
+			log.count.store(count + 1, std::memory_order_release);
+		}
+
+		inline void WriteJsonString(std::ostream& out, std::string_view text)
+		{
+			out << '"';
+			for (char c : text)
+			{
+				if (c == '"' || c == '\\')
+					out << '\\';
+				out << c;
+			}
+			out << '"';
+		}
+	}
+
+	// times one loop, as a member of the iterator that makes it
+	class Probe
+	{
+	public:
+		constexpr Probe() noexcept = default;
+		// a copy of the iterator isn't the loop
+		constexpr Probe(const Probe&) noexcept
+		{}
+		constexpr Probe(Probe&& other) noexcept
+			: kind(other.kind), where(other.where), begin(other.begin), steps(other.steps)
+			, started(std::exchange(other.started, false))
+		{}
+		// keeps timing the loop of the iterator assigned to
+		constexpr Probe& operator=(const Probe&) noexcept
+		{
+			return *this;
+		}
+		constexpr ~Probe()
+		{
+			finish();
+		}
+
+		constexpr void start(const char* loop_kind, std::source_location loop_where) noexcept
+		{
+			if (std::is_constant_evaluated())
+				return;
+			finish();
+			kind = loop_kind;
+			where = loop_where;
+			steps = 0;
+			begin = detail::Ticks();
+			started = true;
+		}
+		constexpr void step(uint64_t count) noexcept
+		{
+			steps += count;
+		}
+
+	private:
+		// a loop that never stepped was a lookup like front() or empty()
+		constexpr void finish() noexcept
+		{
+			if (std::is_constant_evaluated() || !started)
+				return;
+			started = false;
+			if (steps != 0)
+				detail::Append(Record{ 0, kind, where, begin, detail::Ticks() - begin, steps });
+		}
+
+		const char* kind = "loop";
+		std::source_location where;
+		uint64_t begin = 0;
+		uint64_t steps = 0;
+		bool started = false;
+	};
+
+	// the records of all threads so far, with the index of their thread
+	inline std::vector<std::pair<size_t, Record>> Snapshot(uint64_t* dropped = nullptr)
+	{
+		std::vector<std::pair<size_t, Record>> records;
+		if (dropped)
+			*dropped = 0;
+		for (auto* log = detail::Registry::Instance().logs.load(std::memory_order_acquire); log; log = log->next)
+		{
+			const size_t count = log->count.load(std::memory_order_acquire);
+			for (size_t i = 0; i < count; i++)
+				records.emplace_back(log->records[i].thread, log->records[i]);
+			if (dropped)
+				*dropped += log->dropped.load(std::memory_order_relaxed);
+		}
+		return records;
+	}
+
+	// one line per place in the code, the most expensive first
+	inline void WriteFlatProfile(std::ostream& out)
+	{
+		struct Totals
+		{
+			uint64_t calls = 0;
+			uint64_t iterations = 0;
+			uint64_t cycles = 0;
+		};
+		using Site = std::tuple<std::string_view, std::string_view, uint_least32_t, std::string_view>;
+
+		uint64_t dropped;
+		std::map<Site, Totals> sites;
+		uint64_t total_cycles = 0;
+		for (const auto& [thread, record] : Snapshot(&dropped))
+		{
+			auto& totals = sites[Site(record.kind, record.where.file_name(), record.where.line(), record.where.function_name())];
+			totals.calls++;
+			totals.iterations += record.iterations;
+			totals.cycles += record.cycles;
+			total_cycles += record.cycles;
+		}
+		std::vector<std::pair<Site, Totals>> sorted(sites.begin(), sites.end());
+		std::stable_sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) {
+			return lhs.second.cycles > rhs.second.cycles;
+		});
+
+		out << "  time%      calls   iterations         cycles  cycles/iter  loop\n";
+		for (const auto& [site, totals] : sorted)
+		{
+			const auto& [kind, file, line, function] = site;
+			out << std::fixed << std::setprecision(2)
+				<< std::setw(7) << (total_cycles ? 100.0 * totals.cycles / total_cycles : 0.0)
+				<< std::setw(11) << totals.calls
+				<< std::setw(13) << totals.iterations
+				<< std::setw(15) << totals.cycles
+				<< std::setw(13) << (totals.iterations ? static_cast<double>(totals.cycles) / totals.iterations : 0.0)
+				<< "  " << kind << " at " << file << ':' << line << " in " << function << '\n';
+		}
+		if (dropped)
+			out << dropped << " loops were not recorded, raise LOOP_PROFILE_CAPACITY\n";
+	}
+
+	// the Trace Event Format read by chrome://tracing and Perfetto, one complete event per loop
+	inline void WriteChromeTrace(std::ostream& out)
+	{
+		const auto& registry = detail::Registry::Instance();
+		const auto records = Snapshot();
+		// ticks per microsecond, measured over the whole run
+		const double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - registry.epoch_time).count();
+		const double rate = elapsed > 0 ? (detail::Ticks() - registry.epoch_ticks) / elapsed : 1.0;
+
+		out << "{\"traceEvents\":[";
+		bool first = true;
+		for (const auto& [thread, record] : records)
+		{
+			out << (first ? "\n" : ",\n") << "{\"name\":";
+			first = false;
+			detail::WriteJsonString(out, record.kind);
+			out << ",\"cat\":\"loop\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread << std::fixed << std::setprecision(3)
+				<< ",\"ts\":" << (record.start - registry.epoch_ticks) / rate
+				<< ",\"dur\":" << record.cycles / rate
+				<< ",\"args\":{\"iterations\":" << record.iterations << ",\"cycles\":" << record.cycles << ",\"file\":";
+			detail::WriteJsonString(out, record.where.file_name());
+			out << ",\"line\":" << record.where.line() << ",\"function\":";
+			detail::WriteJsonString(out, record.where.function_name());
+			out << "}}";
+		}
+		out << "\n]}\n";
+	}
+}
+
+// hooks for the instrumented classes
+#define LOOP_PROFILE_CALLER , std::source_location loop_caller = std::source_location::current()
+#define LOOP_PROFILE_ONLY_CALLER std::source_location loop_caller = std::source_location::current()
+#define LOOP_PROFILE_INIT , loop_site_(loop_caller)
+#define LOOP_PROFILE_SITE std::source_location loop_site_;
+#define LOOP_PROFILE_PROBE LoopProfiler::Probe loop_probe_;
+#define LOOP_PROFILE_START(iterator, kind, where) (iterator).loop_probe_.start(kind, where)
+#define LOOP_PROFILE_STEP(count) loop_probe_.step(static_cast<uint64_t>(count))
+
+#endif // LOOP_PROFILE
+
+#endif // LOOP_PROFILER_HEADER_
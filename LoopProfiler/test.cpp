@@ -0,0 +1,72 @@
+﻿#define LOOP_PROFILE
+#include "LoopProfiler.h"
+#include "../Pythonic/range.h"
+#include "../Pythonic/enumerate.h"
+#include "../DynArray/DynArray.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+int main()
+{
+	long long sum = 0;
+	for (int i : range(1000))
+		sum += i;
+	assert(sum == 499500);
+
+	std::vector<int> v(100, 1);
+	for (int round = 0; round < 10; round++)
+	{
+		for (auto&& [index, value] : enumerate(v))
+			value += static_cast<int>(index);
+	}
+
+	DynArray<float, 2> arr(30, 40);
+	for (auto& item : arr.iter_all())
+		item = 1.0F;
+	for (auto& row : arr)
+	{
+		for (auto& item : row)
+			item *= 2.0F;
+	}
+
+	// lookups aren't loops
+	auto r = range(10);
+	assert(r[2] == 2 && r.front() == 0 && !r.empty());
+	for (int i : range(100))
+	{
+		if (i == 7)
+			break; // counted up to here
+	}
+
+	for (int round = 0; round < 2; round++)
+	{
+		std::thread worker([] {
+			volatile int sink = 0;
+			for (int i : range(0, 500, 5))
+				sink = sink + i;
+		});
+		worker.join(); // the next worker takes over its log
+	}
+
+	auto records = LoopProfiler::Snapshot();
+	assert(records.size() == 1 + 10 + 1 + 1 + 1 + 2);
+	size_t iterations = 0, threads = 0;
+	for (const auto& [thread, record] : records)
+	{
+		iterations += record.iterations;
+		threads = std::max(threads, thread + 1);
+	}
+	assert(iterations == 1000 + 10 * 100 + 30 * 40 + 30 + 7 + 2 * 100);
+	assert(threads == 3); // the workers are still told apart
+
+	LoopProfiler::WriteFlatProfile(std::cout);
+	std::ostringstream trace;
+	LoopProfiler::WriteChromeTrace(trace);
+	assert(trace.str().find("\"name\":\"enumerate\"") != std::string::npos);
+	assert(trace.str().find("\"tid\":1") != std::string::npos); // the worker
+}
@@ -5,6 +5,19 @@
 #include <type_traits>
 #include <concepts>
 #include <utility>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
 
 enum struct AccessLevel
 {
@@ -72,9 +85,967 @@ private:
 	Type value;
 };
 
+// ------------------ observable mode ------------------
+#ifndef PROPERTY_DISPATCH_INTERVAL_MS
+#define PROPERTY_DISPATCH_INTERVAL_MS 1
+#endif
+
+namespace detail
+{
+	// a property with changes waiting to be published, linked into the dispatcher queue
+	struct PendingNotification
+	{
+		PendingNotification* next = nullptr;
+		void (*publish)(PendingNotification*) = nullptr;
+	};
+
+	// publishes queued changes in batches on its own thread
+	class PropertyDispatcher
+	{
+	public:
+		static PropertyDispatcher& Instance()
+		{
+			static PropertyDispatcher dispatcher;
+			return dispatcher;
+		}
+
+		void Enqueue(PendingNotification* node) noexcept
+		{
+			PendingNotification* head = queue.load(std::memory_order_relaxed);
+			do
+				node->next = head;
+			while (!queue.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+			if (head == nullptr) // wake up once per batch only
+				Wake();
+		}
+		// publish everything queued so far on the calling thread
+		void Flush()
+		{
+			PendingNotification* batch = queue.exchange(nullptr, std::memory_order_acquire);
+			PendingNotification* ordered = nullptr;
+			while (batch) // the queue is a stack, restore the order of the changes
+			{
+				PendingNotification* next = batch->next;
+				batch->next = ordered;
+				ordered = batch;
+				batch = next;
+			}
+			while (ordered)
+			{
+				PendingNotification* next = ordered->next;
+				ordered->publish(ordered);
+				ordered = next;
+			}
+		}
+		// while held, the dispatcher thread leaves the queue to Flush
+		void Hold() noexcept
+		{
+			holds.fetch_add(1, std::memory_order_acq_rel);
+		}
+		void Release() noexcept
+		{
+			if (holds.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				Wake();
+		}
+
+	private:
+		PropertyDispatcher()
+			: worker([this] { Run(); })
+		{}
+		~PropertyDispatcher()
+		{
+			stop.store(true, std::memory_order_release);
+			Wake();
+			worker.join();
+		}
+		void Wake() noexcept
+		{
+			signal.fetch_add(1, std::memory_order_release);
+			signal.notify_one();
+		}
+		void Run()
+		{
+			unsigned seen = 0;
+			while (true)
+			{
+				signal.wait(seen, std::memory_order_acquire);
+				seen = signal.load(std::memory_order_acquire);
+				if (stop.load(std::memory_order_acquire))
+					break;
+				// give the writers time to coalesce further changes into this batch
+				std::this_thread::sleep_for(std::chrono::milliseconds(PROPERTY_DISPATCH_INTERVAL_MS));
+				if (holds.load(std::memory_order_acquire) == 0)
+					Flush();
+			}
+			Flush();
+		}
+
+		std::atomic<PendingNotification*> queue = nullptr;
+		std::atomic<unsigned> signal = 0;
+		std::atomic<int> holds = 0;
+		std::atomic<bool> stop = false;
+		std::thread worker;
+	};
+
+	/*
+	 * What an ObservableProperty shares with the dispatcher: the subscribers
+	 * and the latest value waiting to be published. It's reference counted, so
+	 * a queued or running publish keeps it alive after the property is gone.
+	 */
+	template<typename Type>
+	class ObservableChannel : public PendingNotification
+	{
+	public:
+		struct Subscriber
+		{
+			std::function<void(const Type&)> callback;
+			std::atomic<bool> active = true;
+			Subscriber* next = nullptr; // changed by the publishing thread only, past the head
+		};
+
+		ObservableChannel() noexcept
+		{
+			publish = &Publish;
+		}
+		~ObservableChannel()
+		{
+			delete pending.load(std::memory_order_acquire);
+			for (Subscriber* node = subscribers.load(std::memory_order_acquire); node; )
+				delete std::exchange(node, node->next);
+		}
+
+		Subscriber* Subscribe(std::function<void(const Type&)> callback)
+		{
+			auto* node = new Subscriber{ std::move(callback) };
+			node->next = subscribers.load(std::memory_order_relaxed);
+			while (!subscribers.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+				;
+			observers.fetch_add(1, std::memory_order_relaxed);
+			return node;
+		}
+		void Unsubscribe(Subscriber* node) noexcept
+		{
+			if (node->active.exchange(false, std::memory_order_acq_rel))
+				observers.fetch_sub(1, std::memory_order_relaxed);
+		}
+		bool Observed() const noexcept
+		{
+			return observers.load(std::memory_order_relaxed) != 0;
+		}
+		// hand over a copy of value, queued unless a publish is already due
+		void Notify(const Type& value)
+		{
+			delete pending.exchange(new Type(value), std::memory_order_acq_rel);
+			if (!queued.exchange(true, std::memory_order_acq_rel))
+			{
+				refs.fetch_add(1, std::memory_order_relaxed);
+				PropertyDispatcher::Instance().Enqueue(this);
+			}
+		}
+		// the property is gone, no more calls start
+		void Close() noexcept
+		{
+			closed.store(true, std::memory_order_release);
+			Release();
+		}
+
+	private:
+		void Release() noexcept
+		{
+			if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				delete this;
+		}
+
+		static void Publish(PendingNotification* node)
+		{
+			auto* self = static_cast<ObservableChannel*>(node);
+			std::unique_ptr<Type> latest(self->pending.exchange(nullptr, std::memory_order_acq_rel));
+			if (latest)
+				self->Deliver(*latest);
+			self->queued.store(false, std::memory_order_seq_cst);
+			// a change made while the handlers ran saw the channel still queued
+			if (!self->closed.load(std::memory_order_acquire) && self->pending.load(std::memory_order_seq_cst) &&
+				!self->queued.exchange(true, std::memory_order_acq_rel))
+				PropertyDispatcher::Instance().Enqueue(self); // keeps its reference
+			else
+				self->Release();
+		}
+
+		// calls the active subscribers and frees the others, stops once the property is destroyed
+		void Deliver(const Type& latest)
+		{
+			Subscriber* previous = nullptr;
+			for (Subscriber* sub = subscribers.load(std::memory_order_acquire);
+				 sub && !closed.load(std::memory_order_acquire); )
+			{
+				Subscriber* next = sub->next;
+				if (sub->active.load(std::memory_order_acquire))
+				{
+					sub->callback(latest);
+					previous = sub;
+				}
+				else if (previous)
+				{
+					previous->next = next;
+					delete sub;
+				}
+				else if (Subscriber* head = sub; subscribers.compare_exchange_strong(head, next, std::memory_order_acq_rel))
+					delete sub;
+				else
+					previous = sub; // a new subscriber went in front, unlink it next time
+				sub = next;
+			}
+		}
+
+		std::atomic<Type*> pending = nullptr;
+		std::atomic<bool> queued = false;
+		std::atomic<bool> closed = false;
+		std::atomic<size_t> refs = 1; // the property, and the queue while queued
+		std::atomic<Subscriber*> subscribers = nullptr;
+		std::atomic<size_t> observers = 0;
+	};
+}
+
+// control over the dispatcher thread shared by all observable properties
+struct PropertyNotifications
+{
+	// publishes everything queued so far on the calling thread
+	static void flush()
+	{
+		detail::PropertyDispatcher::Instance().Flush();
+	}
+
+	// while one exists, changes are only published by flush(), e.g. for tests
+	class hold
+	{
+	public:
+		hold() noexcept
+		{
+			detail::PropertyDispatcher::Instance().Hold();
+		}
+		~hold()
+		{
+			detail::PropertyDispatcher::Instance().Release();
+		}
+		hold(const hold&) = delete;
+		hold& operator=(const hold&) = delete;
+	};
+};
+
+/*
+ * ObservableProperty - a Property that publishes its changes
+ * Subscribers are called on the dispatcher thread with the latest value. All
+ * sets between two batches are coalesced into one call, so setters never wait
+ * for the handlers. The channel to the subscribers is allocated by the first
+ * subscribe, so until then a set costs one extra null check.
+ * Subscribing and publishing are lock-free, unsubscribed handlers are freed by
+ * the next publish. Destruction never waits: a call already running may still
+ * finish, and a handler may destroy the property it's called for.
+ */
+template<typename Owner, typename T, AccessLevel Level = AccessLevel::None>
+class ObservableProperty
+{
+	friend typename Owner;
+public:
+	using Type = std::decay_t<T>;
+	using GetType = const Type&;
+	using Callback = std::function<void(const Type&)>;
+
+private:
+	using Channel = detail::ObservableChannel<Type>;
+
+public:
+	using Subscription = const typename Channel::Subscriber*;
+
+	ObservableProperty() requires std::default_initializable<Type>
+		: value()
+	{}
+
+	template<typename V = Type>
+	explicit ObservableProperty(V&& value)
+		: value(std::forward<V>(value))
+	{}
+
+	ObservableProperty(const ObservableProperty&) = delete;
+	ObservableProperty& operator=(const ObservableProperty&) = delete;
+
+	~ObservableProperty()
+	{
+		if (Channel* current = channel.load(std::memory_order_acquire))
+			current->Close();
+	}
+
+public:
+	constexpr GetType get() const noexcept requires detail::Getable<Level>
+	{
+		return value;
+	}
+
+	constexpr operator GetType() const noexcept requires detail::Getable<Level>
+	{
+		return value;
+	}
+
+	template<typename V = Type>
+	void set(V&& other) requires detail::Setable<Level>
+	{
+		value = Type(std::forward<V>(other));
+		notify();
+	}
+
+	template<typename V = Type>
+	ObservableProperty& operator=(V&& other) requires detail::Setable<Level>
+	{
+		set(std::forward<V>(other));
+		return *this;
+	}
+
+	// lock-free, may be called from any thread
+	Subscription subscribe(Callback callback) requires detail::Getable<Level>
+	{
+		Channel* current = channel.load(std::memory_order_acquire);
+		if (!current)
+		{
+			// the first subscribers race to install their channel, the losers drop theirs
+			auto* created = new Channel;
+			if (channel.compare_exchange_strong(current, created, std::memory_order_acq_rel, std::memory_order_acquire))
+				current = created;
+			else
+				delete created;
+		}
+		return current->Subscribe(std::move(callback));
+	}
+
+	// once per subscription, a call already in progress may still finish after this returns
+	void unsubscribe(Subscription subscription) noexcept
+	{
+		channel.load(std::memory_order_acquire)->Unsubscribe(const_cast<typename Channel::Subscriber*>(subscription));
+	}
+
+private:
+	// also for the owner, after it writes the value directly
+	void notify()
+	{
+		if (Channel* current = channel.load(std::memory_order_acquire); current && current->Observed())
+			current->Notify(value);
+	}
+
+private:
+	Type value;
+	std::atomic<Channel*> channel = nullptr; // none until the first subscribe
+};
+
+// ------------------ thread-safe modes ------------------
+namespace detail
+{
+	constexpr std::memory_order LoadOrder(std::memory_order order) noexcept
+	{
+		return order == std::memory_order_release || order == std::memory_order_acq_rel
+			? std::memory_order_acquire : order;
+	}
+	constexpr std::memory_order StoreOrder(std::memory_order order) noexcept
+	{
+		return order == std::memory_order_acquire || order == std::memory_order_acq_rel ||
+			order == std::memory_order_consume ? std::memory_order_release : order;
+	}
+
+	// a published "in use" pointer, owned by one thread at a time and reused after it exits
+	struct HazardSlot
+	{
+		std::atomic<const void*> pointer = nullptr;
+		std::atomic<bool> owned = true;
+		HazardSlot* next = nullptr;
+	};
+
+	// all hazard slots ever handed out, scanned by writers before they free a value
+	class HazardDomain
+	{
+	public:
+		static HazardDomain& Instance()
+		{
+			static HazardDomain domain;
+			return domain;
+		}
+
+		// a free slot of the calling thread, no shared writes unless it needs a new one
+		HazardSlot* Acquire()
+		{
+			thread_local ThreadSlots local;
+			for (HazardSlot* slot : local.slots)
+				if (slot->pointer.load(std::memory_order_relaxed) == nullptr)
+					return slot;
+			local.slots.push_back(Claim());
+			return local.slots.back();
+		}
+
+		template<typename F>
+		void ForEachHazard(F&& fn) const
+		{
+			for (HazardSlot* slot = slots.load(std::memory_order_acquire); slot; slot = slot->next)
+				if (const void* pointer = slot->pointer.load(std::memory_order_seq_cst))
+					fn(pointer);
+		}
+
+	private:
+		struct ThreadSlots
+		{
+			std::vector<HazardSlot*> slots;
+			~ThreadSlots()
+			{
+				for (HazardSlot* slot : slots)
+					slot->owned.store(false, std::memory_order_release);
+			}
+		};
+
+		HazardSlot* Claim()
+		{
+			for (HazardSlot* slot = slots.load(std::memory_order_acquire); slot; slot = slot->next)
+				if (!slot->owned.load(std::memory_order_relaxed) && !slot->owned.exchange(true, std::memory_order_acquire))
+					return slot;
+			auto* slot = new HazardSlot;
+			slot->next = slots.load(std::memory_order_relaxed);
+			while (!slots.compare_exchange_weak(slot->next, slot, std::memory_order_release, std::memory_order_relaxed))
+				;
+			return slot;
+		}
+
+		~HazardDomain()
+		{
+			for (HazardSlot* slot = slots.load(std::memory_order_acquire); slot; )
+				delete std::exchange(slot, slot->next);
+		}
+
+		std::atomic<HazardSlot*> slots = nullptr; // never shrinks, bounded by the live snapshots
+	};
+
+	// a value of an RCUProperty protected from being freed while it's held
+	template<typename Type>
+	class RCUSnapshot
+	{
+	public:
+		RCUSnapshot(const std::atomic<const Type*>& source)
+			: slot(HazardDomain::Instance().Acquire())
+		{
+			value = source.load(std::memory_order_acquire);
+			while (true) // published, then checked to still be current, so no writer missed it
+			{
+				slot->pointer.store(value, std::memory_order_seq_cst);
+				const Type* current = source.load(std::memory_order_seq_cst);
+				if (current == value)
+					break;
+				value = current;
+			}
+		}
+		RCUSnapshot(RCUSnapshot&& other) noexcept
+			: slot(std::exchange(other.slot, nullptr)), value(other.value)
+		{}
+		RCUSnapshot& operator=(RCUSnapshot&&) = delete;
+		~RCUSnapshot()
+		{
+			if (slot)
+				slot->pointer.store(nullptr, std::memory_order_release);
+		}
+
+		const Type& operator*() const noexcept
+		{
+			return *value;
+		}
+		const Type* operator->() const noexcept
+		{
+			return value;
+		}
+		const Type* get() const noexcept
+		{
+			return value;
+		}
+
+	private:
+		HazardSlot* slot;
+		const Type* value;
+	};
+}
+
+/*
+ * AtomicProperty - a Property over std::atomic<T> for trivially copyable T
+ * Order is used for both sides, a release order loads with acquire and an
+ * acquire order stores with release.
+ */
+template<typename Owner, typename T, AccessLevel Level = AccessLevel::None,
+		 std::memory_order Order = std::memory_order_seq_cst>
+class AtomicProperty
+{
+	friend typename Owner;
+public:
+	using Type = std::decay_t<T>;
+	using GetType = Type;
+	static_assert(std::is_trivially_copyable_v<Type>, "AtomicProperty needs a trivially copyable type.");
+
+public:
+	AtomicProperty() requires std::default_initializable<Type> = default;
+
+	template<typename V = Type>
+	explicit constexpr AtomicProperty(V&& value) noexcept(detail::CanNothrowInit<Type, V>)
+		: value(Type(std::forward<V>(value)))
+	{}
+
+public:
+	GetType get() const noexcept requires detail::Getable<Level>
+	{
+		return value.load(detail::LoadOrder(Order));
+	}
+
+	operator GetType() const noexcept requires detail::Getable<Level>
+	{
+		return get();
+	}
+
+	template<typename V = Type>
+	void set(V&& other) noexcept(detail::CanNothrowInit<Type, V>)
+		requires detail::Setable<Level>
+	{
+		value.store(Type(std::forward<V>(other)), detail::StoreOrder(Order));
+	}
+
+	template<typename V = Type>
+	AtomicProperty& operator=(V&& other) noexcept(detail::CanNothrowInit<Type, V>)
+		requires detail::Setable<Level>
+	{
+		set(std::forward<V>(other));
+		return *this;
+	}
+
+private:
+	std::atomic<Type> value;
+};
+
+/*
+ * SeqLockProperty - for larger trivially copyable values that are read far
+ * more often than written. Readers never block nor write shared memory, they
+ * retry when a set overlapped their copy. Sets are serialized among themselves.
+ */
+template<typename Owner, typename T, AccessLevel Level = AccessLevel::None>
+class SeqLockProperty
+{
+	friend typename Owner;
+public:
+	using Type = std::decay_t<T>;
+	using GetType = Type;
+	static_assert(std::is_trivially_copyable_v<Type>, "SeqLockProperty needs a trivially copyable type.");
+
+public:
+	SeqLockProperty() requires std::default_initializable<Type>
+		: SeqLockProperty(Type())
+	{}
+
+	template<typename V = Type>
+	explicit SeqLockProperty(V&& value) noexcept(detail::CanNothrowInit<Type, V>)
+	{
+		store(Type(std::forward<V>(value)));
+	}
+
+public:
+	GetType get() const noexcept requires detail::Getable<Level>
+	{
+		return load();
+	}
+
+	operator GetType() const noexcept requires detail::Getable<Level>
+	{
+		return load();
+	}
+
+	template<typename V = Type>
+	void set(V&& other) noexcept(detail::CanNothrowInit<Type, V>)
+		requires detail::Setable<Level>
+	{
+		const Type updated(std::forward<V>(other));
+		// an odd sequence marks a set in progress, taking it from even serializes the writers
+		unsigned long long seq = sequence.load(std::memory_order_relaxed);
+		while (seq % 2 != 0 || !sequence.compare_exchange_weak(seq, seq + 1, std::memory_order_relaxed))
+		{
+			std::this_thread::yield();
+			seq = sequence.load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_release);
+		store(updated);
+		sequence.store(seq + 2, std::memory_order_release);
+	}
+
+	template<typename V = Type>
+	SeqLockProperty& operator=(V&& other) noexcept(detail::CanNothrowInit<Type, V>)
+		requires detail::Setable<Level>
+	{
+		set(std::forward<V>(other));
+		return *this;
+	}
+
+private:
+	static constexpr size_t WordCount = (sizeof(Type) + sizeof(unsigned long long) - 1) / sizeof(unsigned long long);
+
+	// the words are atomics so that a torn read is a retry rather than a data race
+	void store(const Type& updated) noexcept
+	{
+		unsigned long long buffer[WordCount] = {};
+		std::memcpy(buffer, &updated, sizeof(Type));
+		for (size_t i = 0; i < WordCount; i++)
+			value[i].store(buffer[i], std::memory_order_relaxed);
+	}
+	Type load() const noexcept
+	{
+		unsigned long long buffer[WordCount];
+		while (true)
+		{
+			const unsigned long long before = sequence.load(std::memory_order_acquire);
+			for (size_t i = 0; i < WordCount; i++)
+				buffer[i] = value[i].load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (before % 2 == 0 && sequence.load(std::memory_order_relaxed) == before)
+				break;
+		}
+		struct { unsigned char bytes[sizeof(Type)]; } raw;
+		std::memcpy(raw.bytes, buffer, sizeof(Type));
+		return std::bit_cast<Type>(raw);
+	}
+
+private:
+	std::atomic<unsigned long long> sequence = 0;
+	std::atomic<unsigned long long> value[WordCount];
+};
+
+/*
+ * RCUProperty - readers take a snapshot of an immutable value, a set swaps in
+ * a new one. Reads are lock-free and write nothing shared: a snapshot holds
+ * the value through a hazard pointer of its thread. Sets are serialized, and
+ * free the old values no snapshot holds any more. Snapshots must not outlive
+ * the property.
+ */
+template<typename Owner, typename T, AccessLevel Level = AccessLevel::None>
+class RCUProperty
+{
+	friend typename Owner;
+public:
+	using Type = std::decay_t<T>;
+	using GetType = detail::RCUSnapshot<Type>;
+
+public:
+	RCUProperty() requires std::default_initializable<Type>
+		: value(new Type())
+	{}
+
+	template<typename V = Type>
+	explicit RCUProperty(V&& value)
+		: value(new Type(std::forward<V>(value)))
+	{}
+
+	RCUProperty(const RCUProperty&) = delete;
+	RCUProperty& operator=(const RCUProperty&) = delete;
+
+	~RCUProperty()
+	{
+		delete value.load(std::memory_order_acquire);
+		for (const Type* old : retired)
+			delete old;
+	}
+
+public:
+	GetType get() const requires detail::Getable<Level>
+	{
+		return GetType(value);
+	}
+
+	operator GetType() const requires detail::Getable<Level>
+	{
+		return get();
+	}
+
+	template<typename V = Type>
+	void set(V&& other) requires detail::Setable<Level>
+	{
+		auto* updated = new Type(std::forward<V>(other));
+		std::lock_guard guard(writer);
+		Replace(updated);
+	}
+
+	template<typename V = Type>
+	RCUProperty& operator=(V&& other) requires detail::Setable<Level>
+	{
+		set(std::forward<V>(other));
+		return *this;
+	}
+
+	// read-copy-update: fn changes a copy of the current value, no other set comes in between
+	template<typename F>
+	void update(F&& fn) requires detail::Setable<Level>
+	{
+		std::lock_guard guard(writer);
+		auto updated = std::make_unique<Type>(*value.load(std::memory_order_relaxed));
+		fn(*updated);
+		Replace(updated.release());
+	}
+
+private:
+	static constexpr size_t ScanThreshold = 16;
+
+	void Replace(const Type* updated)
+	{
+		retired.push_back(value.exchange(updated, std::memory_order_seq_cst));
+		if (retired.size() >= ScanThreshold)
+			Reclaim();
+	}
+
+	// frees the retired values no reader has published
+	void Reclaim()
+	{
+		std::vector<const void*> hazards;
+		detail::HazardDomain::Instance().ForEachHazard([&](const void* pointer) { hazards.push_back(pointer); });
+		std::erase_if(retired, [&](const Type* old) {
+			if (std::find(hazards.begin(), hazards.end(), old) != hazards.end())
+				return false;
+			delete old;
+			return true;
+		});
+	}
+
+private:
+	std::atomic<const Type*> value;
+	std::mutex writer;
+	std::vector<const Type*> retired;
+};
+
+// ------------------ lazy mode ------------------
+
+/*
+ * TrackedProperty - a Property that counts its sets, so that the
+ * LazyProperty values derived from it know when to recompute.
+ */
+template<typename Owner, typename T, AccessLevel Level = AccessLevel::None>
+class TrackedProperty
+{
+	friend typename Owner;
+public:
+	using Type = std::decay_t<T>;
+	using GetType = const Type&;
+
+public:
+	TrackedProperty() requires std::default_initializable<Type> = default;
+
+	template<typename V = Type>
+	explicit constexpr TrackedProperty(V&& value) noexcept(detail::CanNothrowInit<Type, V>)
+		: value(std::forward<V>(value))
+	{}
+
+public:
+	constexpr GetType get() const noexcept requires detail::Getable<Level>
+	{
+		return value;
+	}
+
+	constexpr operator GetType() const noexcept requires detail::Getable<Level>
+	{
+		return value;
+	}
+
+	template<typename V = Type>
+	void set(V&& other) noexcept(detail::CanNothrowSet<Type, V>)
+		requires detail::Setable<Level>
+	{
+		value = Type(std::forward<V>(other));
+		notify();
+	}
+
+	template<typename V = Type>
+	TrackedProperty& operator=(V&& other) noexcept(detail::CanNothrowSet<Type, V>)
+		requires detail::Setable<Level>
+	{
+		set(std::forward<V>(other));
+		return *this;
+	}
+
+	unsigned long long version() const noexcept
+	{
+		return revision.load(std::memory_order_acquire);
+	}
+
+private:
+	// also for the owner, after it writes the value directly
+	void notify() noexcept
+	{
+		revision.fetch_add(1, std::memory_order_release);
+	}
+
+private:
+	Type value;
+	std::atomic<unsigned long long> revision = 0;
+};
+
+/*
+ * LazyProperty - a value computed by (owner.*Compute)() on the first get and
+ * cached until one of the Dependencies (pointers to TrackedProperty members
+ * of the owner) is set. Concurrent gets compute it only once and return
+ * copies, so a recompute never changes a value a reader still uses. Like any
+ * other Property, a get must not race with a set it depends on.
+ *   LazyProperty<Box, Get, &Mesh::ComputeBounds, &Mesh::vertices> bounds{ this };
+ */
+template<typename Owner, typename T, AccessLevel Level, auto Compute, auto... Dependencies>
+class LazyProperty
+{
+	friend typename Owner;
+public:
+	using Type = std::decay_t<T>;
+	using GetType = Type;
+
+public:
+	explicit LazyProperty(const Owner* owner) noexcept
+		: owner(owner)
+	{}
+
+	// the cache belongs to one owner
+	LazyProperty(const LazyProperty&) = delete;
+	LazyProperty& operator=(const LazyProperty&) = delete;
+
+public:
+	GetType get() const requires detail::Getable<Level>
+	{
+		return load();
+	}
+
+	operator GetType() const requires detail::Getable<Level>
+	{
+		return load();
+	}
+
+private:
+	// also for the owner, when something else the value depends on has changed
+	void invalidate() noexcept
+	{
+		stamp.store(0, std::memory_order_release);
+	}
+
+	// the sets seen by all dependencies, which only grows, so any set changes it
+	unsigned long long version() const noexcept
+	{
+		return (1ULL + ... + (owner->*Dependencies).version());
+	}
+
+	Type load() const
+	{
+		const unsigned long long current = version();
+		{
+			std::shared_lock reading(lock);
+			if (stamp.load(std::memory_order_acquire) == current)
+				return *value;
+		}
+		std::lock_guard writing(lock);
+		if (stamp.load(std::memory_order_relaxed) != current)
+		{
+			value = std::invoke(Compute, *owner);
+			stamp.store(current, std::memory_order_release);
+		}
+		return *value;
+	}
+
+private:
+	const Owner* owner;
+	mutable std::optional<Type> value;
+	mutable std::atomic<unsigned long long> stamp = 0; // the version the value was computed for
+	mutable std::shared_mutex lock; // shared while copying the value out
+};
+
+// ------------------ accessor mode ------------------
+#if defined(_MSC_VER)
+#define PROPERTY_NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
+#else
+#define PROPERTY_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#endif
+
+#if defined(__GNUC__)
+// offsetof is fine on the owners we use it on, but GCC warns about any class that isn't standard layout
+#define PROPERTY_RETURN_OFFSETOF(OwnerType, Name) \
+	_Pragma("GCC diagnostic push") \
+	_Pragma("GCC diagnostic ignored \"-Winvalid-offsetof\"") \
+	return offsetof(OwnerType, Name); \
+	_Pragma("GCC diagnostic pop")
+#else
+#define PROPERTY_RETURN_OFFSETOF(OwnerType, Name) return offsetof(OwnerType, Name);
+#endif
+
+/*
+ * AccessorProperty - a Property without storage of its own, get and set call
+ * (owner.*Getter)() and (owner.*Setter)(value), e.g. to expose a bit-field of a
+ * flags word. Locate() gives the offset of the property in its owner, which is
+ * how it finds the owner without keeping a pointer. Declare one with
+ * AccessorPropertyField, which also defines Locate and drops the storage.
+ * Setter may be nullptr for a property that is only read.
+ */
+template<typename Owner, typename T, AccessLevel Level, auto Getter, auto Setter, auto Locate>
+class AccessorProperty
+{
+	friend typename Owner;
+public:
+	using Type = std::decay_t<T>;
+	using GetType = Type;
+
+public:
+	AccessorProperty() = default;
+
+public:
+	GetType get() const requires detail::Getable<Level>
+	{
+		return std::invoke(Getter, owner());
+	}
+
+	operator GetType() const requires detail::Getable<Level>
+	{
+		return get();
+	}
+
+	template<typename V = Type>
+	void set(V&& other) requires detail::Setable<Level> && (!std::is_null_pointer_v<decltype(Setter)>)
+	{
+		std::invoke(Setter, owner(), Type(std::forward<V>(other)));
+	}
+
+	template<typename V = Type>
+	AccessorProperty& operator=(V&& other) requires detail::Setable<Level> && (!std::is_null_pointer_v<decltype(Setter)>)
+	{
+		set(std::forward<V>(other));
+		return *this;
+	}
+
+private:
+	const Owner& owner() const noexcept
+	{
+		return *reinterpret_cast<const Owner*>(reinterpret_cast<const char*>(this) - Locate());
+	}
+	Owner& owner() noexcept
+	{
+		return *reinterpret_cast<Owner*>(reinterpret_cast<char*>(this) - Locate());
+	}
+};
+
+// AccessorPropertyField(int, GetSet, &Flags::GetMode, &Flags::SetMode, mode);
+#define AccessorPropertyField(T, Level, Getter, Setter, Name) \
+	static std::size_t Name##_offset() noexcept { PROPERTY_RETURN_OFFSETOF(PropertyOwner, Name) } \
+	PROPERTY_NO_UNIQUE_ADDRESS AccessorProperty<T, Level, Getter, Setter, &PropertyOwner::Name##_offset> Name
+
 #define UsingProperty(OwnerType) \
 	using enum AccessLevel; \
+	using PropertyOwner = OwnerType; \
+	template<typename T, AccessLevel Level> \
+	using Property = Property<OwnerType, T, Level>; \
+	template<typename T, AccessLevel Level> \
+	using ObservableProperty = ObservableProperty<OwnerType, T, Level>; \
+	template<typename T, AccessLevel Level, std::memory_order Order = std::memory_order_seq_cst> \
+	using AtomicProperty = AtomicProperty<OwnerType, T, Level, Order>; \
+	template<typename T, AccessLevel Level> \
+	using SeqLockProperty = SeqLockProperty<OwnerType, T, Level>; \
+	template<typename T, AccessLevel Level> \
+	using RCUProperty = RCUProperty<OwnerType, T, Level>; \
 	template<typename T, AccessLevel Level> \
-	using Property = Property<OwnerType, T, Level>
+	using TrackedProperty = TrackedProperty<OwnerType, T, Level>; \
+	template<typename T, AccessLevel Level, auto Compute, auto... Dependencies> \
+	using LazyProperty = LazyProperty<OwnerType, T, Level, Compute, Dependencies...>; \
+	template<typename T, AccessLevel Level, auto Getter, auto Setter, auto Locate> \
+	using AccessorProperty = AccessorProperty<OwnerType, T, Level, Getter, Setter, Locate>
 
 #endif // PROPERTY_HEADER_
\ No newline at end of file
@@ -1,5 +1,9 @@
 ﻿#include "Property.h"
 #include <cassert>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <memory>
 
 void f1(short value)
 {
@@ -51,6 +55,71 @@ public:
 	A() : num3(42) {}
 };
 
+class B
+{
+	UsingProperty(B);
+public:
+	ObservableProperty<int, GetSet> o1{ 1 };
+	ObservableProperty<int, Get> o2{ 2 };
+	void foo()
+	{
+		o2.value = 22;
+		o2.notify(); // the owner publishes its own writes, nothing to do without subscribers
+	}
+};
+
+struct Bounds
+{
+	double min[3];
+	double max[3];
+};
+
+class C
+{
+	UsingProperty(C);
+public:
+	AtomicProperty<int, GetSet> a1{ 1 };
+	AtomicProperty<int, Get, std::memory_order_acq_rel> a2{ 2 };
+	SeqLockProperty<Bounds, GetSet> bounds;
+	RCUProperty<std::string, GetSet> name{ "c" };
+};
+
+class D
+{
+	UsingProperty(D);
+	double Area() const
+	{
+		computed++;
+		return width.value * height.value;
+	}
+public:
+	mutable std::atomic<int> computed = 0;
+	TrackedProperty<double, GetSet> width{ 2 };
+	TrackedProperty<double, GetSet> height{ 3 };
+	LazyProperty<double, Get, &D::Area, &D::width, &D::height> area{ this };
+	void foo()
+	{
+		width.value = 5;
+		width.notify();
+	}
+};
+
+class E
+{
+	UsingProperty(E);
+	unsigned flags = 0;
+	unsigned Mode() const { return flags & 3; }
+	void SetMode(unsigned mode) { flags = (flags & ~3u) | (mode & 3); }
+	bool Visible() const { return flags & 4; }
+	void SetVisible(bool visible) { flags = visible ? flags | 4 : flags & ~4u; }
+	unsigned Flags() const { return flags; }
+public:
+	AccessorPropertyField(unsigned, GetSet, &E::Mode, &E::SetMode, mode);
+	AccessorPropertyField(bool, GetSet, &E::Visible, &E::SetVisible, visible);
+	AccessorPropertyField(unsigned, Get, &E::Flags, nullptr, raw);
+};
+static_assert(sizeof(E) == sizeof(unsigned)); // views over the flags word, nothing stored
+
 int main()
 {
 	A a;
@@ -75,4 +144,92 @@ int main()
 
 	assert(a.num2.get() == 42);
 	assert(a.num3.get() == 42);
+
+	B b;
+	b.foo();
+	assert(b.o2 == 22);
+	{
+		PropertyNotifications::hold manual; // publish on flush() only
+		int seen = 0, calls = 0;
+		auto token = std::make_shared<int>();
+		auto sub = b.o1.subscribe([&, token](int v) { seen = v; calls++; });
+		b.o1 = 2;
+		b.o1 = 3;
+		b.o1.set(4); // published together with the sets above
+		PropertyNotifications::flush();
+		assert(seen == 4 && calls == 1);
+		b.o1.unsubscribe(sub);
+		b.o1 = 5;
+		PropertyNotifications::flush();
+		assert(seen == 4 && calls == 1);
+		auto other = b.o1.subscribe([&](int v) { seen = v; });
+		b.o1 = 6;
+		PropertyNotifications::flush();
+		assert(seen == 6 && token.use_count() == 1); // the unsubscribed handler is freed
+		b.o1.unsubscribe(other);
+
+		auto owner = new B;
+		owner->o1.subscribe([&](int v) { seen = v; delete owner; }); // a handler may destroy the property
+		owner->o1 = 7;
+		PropertyNotifications::flush();
+		assert(seen == 7);
+
+		std::atomic<int> delivered = 0;
+		B racing;
+		std::thread first([&] { racing.o1.subscribe([&](int) { delivered++; }); });
+		racing.o1.subscribe([&](int) { delivered++; }); // whichever comes first creates the channel
+		first.join();
+		racing.o1 = 8;
+		PropertyNotifications::flush();
+		assert(delivered == 2);
+	}
+
+	C c;
+	c.a1 = 10;
+	assert(c.a1 == 10 && c.a2.get() == 2);
+	std::thread writer([&] {
+		for (double i = 1; i <= 1000; i++)
+		{
+			c.bounds = Bounds{ { -i, -i, -i }, { i, i, i } };
+			c.name.update([](std::string& s) { s += '.'; });
+		}
+	});
+	for (int i = 0; i < 1000; i++)
+	{
+		Bounds b = c.bounds;
+		assert(b.min[0] == -b.max[2]); // never torn
+		auto name = c.name.get();
+		assert(name->front() == 'c');
+	}
+	writer.join();
+	assert(c.bounds.get().max[1] == 1000);
+	assert(c.name.get()->size() == 1001);
+	c.name = "renamed";
+	assert(*c.name.get() == "renamed");
+	{
+		auto held = c.name.get();
+		for (int i = 0; i < 100; i++)
+			c.name = std::to_string(i); // old values are freed, except the held one
+		assert(*held == "renamed" && *c.name.get() == "99");
+	}
+
+	D d;
+	std::thread readers[4];
+	for (auto& reader : readers)
+		reader = std::thread([&] { assert(d.area == 6); });
+	for (auto& reader : readers)
+		reader.join();
+	assert(d.area.get() == 6 && d.computed == 1); // computed once
+	d.height = 4;
+	assert(d.area == 8 && d.area == 8 && d.computed == 2);
+	d.foo();
+	assert(d.area == 20 && d.computed == 3);
+
+	E e;
+	e.mode = 2;
+	e.visible = true;
+	assert(e.mode == 2 && e.visible && e.raw == 6);
+	e.mode.set(1);
+	e.visible = false;
+	assert(e.mode.get() == 1 && !e.visible && e.raw == 1);
 }
\ No newline at end of file
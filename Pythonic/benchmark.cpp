@@ -0,0 +1,151 @@
+﻿#include "range.h"
+#include "enumerate.h"
+#include "zip.h"
+#include "chunked.h"
+#include "stride.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+
+/*
+ * Compares the adaptors with the loops they replace. With optimization on,
+ * both loops of a pair should compile to the same single induction variable,
+ * which can be checked by building with -S (or /FA) and diffing the two
+ * functions of a pair.
+ */
+
+// benchmarks are built with NDEBUG, so the results are checked without assert
+void Check(bool ok, const char* what)
+{
+	if (!ok)
+	{
+		std::cerr << "check failed: " << what << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+}
+
+template<typename F>
+double Measure(F&& loop)
+{
+	constexpr size_t Rounds = 100;
+	volatile long long sink = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < Rounds; i++)
+		sink = sink + loop();
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count() / Rounds;
+}
+
+long long IndexedLoop(const std::vector<int>& v)
+{
+	long long sum = 0;
+	for (size_t i = 0; i < v.size(); i++)
+		sum += v[i] * static_cast<long long>(i);
+	return sum;
+}
+
+long long EnumerateLoop(const std::vector<int>& v)
+{
+	long long sum = 0;
+	for (auto [index, value] : enumerate(v))
+		sum += value * static_cast<long long>(index);
+	return sum;
+}
+
+long long PointerZip(const std::vector<int>& a, const std::vector<int>& b)
+{
+	long long sum = 0;
+	const int* pa = a.data();
+	const int* pb = b.data();
+	for (const int* end = pa + std::min(a.size(), b.size()); pa != end; ++pa, ++pb)
+		sum += *pa * static_cast<long long>(*pb);
+	return sum;
+}
+
+long long ZipLoop(const std::vector<int>& a, const std::vector<int>& b)
+{
+	long long sum = 0;
+	for (auto [x, y] : zip(a, b))
+		sum += x * static_cast<long long>(y);
+	return sum;
+}
+
+constexpr size_t Block = 8;
+
+long long PointerChunks(const std::vector<int>& v)
+{
+	long long sum = 0;
+	const int* p = v.data();
+	const int* end = p + v.size();
+	for (; end - p >= static_cast<std::ptrdiff_t>(Block); p += Block)
+	{
+		for (size_t i = 0; i < Block; i++)
+			sum += p[i];
+	}
+	for (; p != end; ++p)
+		sum += *p;
+	return sum;
+}
+
+long long ChunkedLoop(const std::vector<int>& v)
+{
+	long long sum = 0;
+	for (auto chunk : chunked(v, Block))
+	{
+		if (chunk.size() == Block)
+		{
+			// a fixed extent lets the inner loop be fully unrolled and vectorised
+			for (int x : chunk.first<Block>())
+				sum += x;
+		}
+		else
+		{
+			for (int x : chunk)
+				sum += x;
+		}
+	}
+	return sum;
+}
+
+long long PointerStride(const std::vector<int>& v)
+{
+	long long sum = 0;
+	const int* p = v.data();
+	for (size_t i = 0; i < v.size(); i += 4)
+		sum += p[i];
+	return sum;
+}
+
+long long StrideLoop(const std::vector<int>& v)
+{
+	long long sum = 0;
+	for (int x : stride(v, 4))
+		sum += x;
+	return sum;
+}
+
+int main()
+{
+	std::vector<int> v(1 << 22);
+	for (auto [index, value] : enumerate(v))
+		value = static_cast<int>(index % 1000);
+	Check(IndexedLoop(v) == EnumerateLoop(v), "enumerate matches the indexed loop");
+
+	std::cout << "indexed loop:   " << Measure([&] { return IndexedLoop(v); }) << " ms\n";
+	std::cout << "enumerate loop: " << Measure([&] { return EnumerateLoop(v); }) << " ms\n";
+
+	std::vector<int> w(v.rbegin(), v.rend());
+	Check(PointerZip(v, w) == ZipLoop(v, w), "zip matches the pointer loop");
+	Check(PointerChunks(v) == ChunkedLoop(v), "chunked matches the pointer loop");
+	Check(PointerStride(v) == StrideLoop(v), "stride matches the pointer loop");
+	std::cout << "pointer zip:    " << Measure([&] { return PointerZip(v, w); }) << " ms\n";
+	std::cout << "zip loop:       " << Measure([&] { return ZipLoop(v, w); }) << " ms\n";
+	std::cout << "pointer blocks: " << Measure([&] { return PointerChunks(v); }) << " ms\n";
+	std::cout << "chunked loop:   " << Measure([&] { return ChunkedLoop(v); }) << " ms\n";
+	std::cout << "pointer stride: " << Measure([&] { return PointerStride(v); }) << " ms\n";
+	std::cout << "stride loop:    " << Measure([&] { return StrideLoop(v); }) << " ms\n";
+}
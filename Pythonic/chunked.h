@@ -0,0 +1,137 @@
+﻿#pragma once
+
+#include <utility>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <memory>
+#include <type_traits>
+#include <compare>
+#include <cstddef>
+#include <algorithm>
+#include <cassert>
+
+/*
+ * chunked(v, n) - consecutive chunks of n elements, the last one may be shorter.
+ * Chunks of contiguous ranges are std::span, so a body can hand full chunks to
+ * a fixed-size kernel, e.g. chunk.first<8>(), and treat a short tail apart.
+ */
+template<typename Container>
+class chunked : public std::ranges::view_interface<chunked<Container>>
+{
+	using Base = std::views::all_t<Container>;
+	template<bool Const>
+	using MaybeConst = std::conditional_t<Const, const Base, Base>;
+
+	static_assert(std::ranges::random_access_range<Base> && std::ranges::sized_range<Base>,
+				  "chunked needs a sized random access range.");
+
+public:
+	template<bool Const>
+	class chunked_iterator
+	{
+		using Iter = std::ranges::iterator_t<MaybeConst<Const>>;
+		friend class chunked_iterator<!Const>;
+
+	public:
+		using iterator_concept = std::random_access_iterator_tag;
+		using iterator_category = std::input_iterator_tag; // chunks are yielded by value
+		using difference_type = std::ranges::range_difference_t<MaybeConst<Const>>;
+		using value_type = std::conditional_t<std::ranges::contiguous_range<MaybeConst<Const>>,
+			std::span<std::remove_reference_t<std::ranges::range_reference_t<MaybeConst<Const>>>>,
+			std::ranges::subrange<Iter>>;
+		using reference = value_type;
+
+	public:
+		chunked_iterator() = default;
+		constexpr chunked_iterator(Iter first, difference_type index, difference_type chunk_size, difference_type size) noexcept
+			:_first(std::move(first)), _index(index), _chunk_size(chunk_size), _size(size)
+		{}
+		constexpr chunked_iterator(chunked_iterator<!Const> other) noexcept
+			requires Const && std::convertible_to<std::ranges::iterator_t<Base>, Iter>
+			:_first(std::move(other._first)), _index(other._index), _chunk_size(other._chunk_size), _size(other._size)
+		{}
+
+		constexpr reference operator*() const noexcept {
+			return (*this)[0];
+		}
+		constexpr reference operator[](difference_type n) const noexcept {
+			const difference_type offset = (_index + n) * _chunk_size;
+			auto first = _first + offset;
+			const auto length = std::min(_chunk_size, _size - offset);
+			if constexpr (std::ranges::contiguous_range<MaybeConst<Const>>)
+				return reference(std::to_address(first), static_cast<size_t>(length));
+			else
+				return reference(first, first + length);
+		}
+		constexpr chunked_iterator& operator++() noexcept { ++_index; return *this; }
+		constexpr chunked_iterator operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+		constexpr chunked_iterator& operator--() noexcept { --_index; return *this; }
+		constexpr chunked_iterator operator--(int) noexcept { auto tmp = *this; --*this; return tmp; }
+		constexpr chunked_iterator& operator+=(difference_type n) noexcept { _index += n; return *this; }
+		constexpr chunked_iterator& operator-=(difference_type n) noexcept { _index -= n; return *this; }
+		friend constexpr chunked_iterator operator+(chunked_iterator it, difference_type n) noexcept { return it += n; }
+		friend constexpr chunked_iterator operator+(difference_type n, chunked_iterator it) noexcept { return it += n; }
+		friend constexpr chunked_iterator operator-(chunked_iterator it, difference_type n) noexcept { return it -= n; }
+		friend constexpr difference_type operator-(const chunked_iterator& lhs, const chunked_iterator& rhs) noexcept {
+			return lhs._index - rhs._index;
+		}
+		friend constexpr bool operator==(const chunked_iterator& lhs, const chunked_iterator& rhs) noexcept {
+			return lhs._index == rhs._index;
+		}
+		friend constexpr auto operator<=>(const chunked_iterator& lhs, const chunked_iterator& rhs) noexcept {
+			return lhs._index <=> rhs._index;
+		}
+
+	private:
+		Iter _first = Iter();
+		difference_type _index = 0;
+		difference_type _chunk_size = 1;
+		difference_type _size = 0;
+	};
+
+public:
+	chunked() requires std::default_initializable<Base> = default;
+	template<typename T>
+	constexpr chunked(T&& container, size_t chunk_size) noexcept
+		:_container(std::views::all(std::forward<T>(container))), _chunk_size(chunk_size)
+	{
+		assert(chunk_size > 0);
+	}
+	constexpr auto begin() noexcept {
+		return iterator_at<false>(_container, 0);
+	}
+	constexpr auto begin() const noexcept requires std::ranges::random_access_range<const Base> {
+		return iterator_at<true>(_container, 0);
+	}
+	constexpr auto end() noexcept {
+		return iterator_at<false>(_container, size());
+	}
+	constexpr auto end() const noexcept requires std::ranges::random_access_range<const Base> {
+		return iterator_at<true>(_container, size());
+	}
+	constexpr size_t size() const noexcept {
+		const auto count = static_cast<size_t>(std::ranges::size(_container));
+		return (count + _chunk_size - 1) / _chunk_size;
+	}
+
+private:
+	template<bool Const, typename Parent>
+	constexpr auto iterator_at(Parent& container, size_t index) const noexcept
+	{
+		using Difference = std::ranges::range_difference_t<Parent>;
+		return chunked_iterator<Const>(std::ranges::begin(container), static_cast<Difference>(index),
+									   static_cast<Difference>(_chunk_size),
+									   static_cast<Difference>(std::ranges::size(container)));
+	}
+
+	Base _container;
+	size_t _chunk_size = 1;
+};
+
+template<typename T>
+chunked(T&&, size_t)->chunked<T>;
+
+template<typename Container>
+inline constexpr bool std::ranges::enable_borrowed_range<chunked<Container>> =
+	std::is_lvalue_reference_v<Container> || std::ranges::enable_borrowed_range<std::remove_cvref_t<Container>>;
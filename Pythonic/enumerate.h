@@ -3,85 +3,233 @@
 #include <utility>
 #include <initializer_list>
 #include <iterator>
+#include <ranges>
+#include <type_traits>
+#include <concepts>
+#include <compare>
+#include <cstddef>
+
+// loop hooks, no-ops unless LoopProfiler.h was included first with LOOP_PROFILE
+#ifndef LOOP_PROFILE_HOOKS
+#define LOOP_PROFILE_HOOKS
+#define LOOP_PROFILE_CALLER
+#define LOOP_PROFILE_ONLY_CALLER
+#define LOOP_PROFILE_INIT
+#define LOOP_PROFILE_SITE
+#define LOOP_PROFILE_PROBE
+#define LOOP_PROFILE_START(iterator, kind, where) static_cast<void>(0)
+#define LOOP_PROFILE_STEP(count) static_cast<void>(0)
+#endif
 
 template<typename Container>
-class enumerate
+class enumerate : public std::ranges::view_interface<enumerate<Container>>
 {
+	// ranges are held as views: a reference to lvalues, owned for rvalues,
+	// except initializer_list, which is a cheap view itself but can't be owned by one
+	template<typename T>
+	struct base_of { using type = std::views::all_t<T>; };
+	template<typename T>
+	struct base_of<std::initializer_list<T>> { using type = std::initializer_list<T>; };
+
+	using Base = typename base_of<Container>::type;
+	template<bool Const>
+	using MaybeConst = std::conditional_t<Const, const Base, Base>;
+
 public:
+	template<typename V>
+	struct item_pair
+	{
+		template<typename T>
+		constexpr item_pair(size_t index, T&& value) noexcept
+			:_index(index), _value(std::forward<T>(value))
+		{}
+		size_t _index;
+		V _value; // a reference when the underlying range yields one
+	};
+
+	template<bool Const>
 	class enumerate_iterator
 	{
+		using Iter = std::ranges::iterator_t<MaybeConst<Const>>;
+		friend class enumerate_iterator<!Const>;
+
 	public:
-		using Iter = decltype(std::begin(std::declval<Container>()));
-
-		template<typename V>
-		struct item_pair
-		{
-			template<typename T>
-			constexpr item_pair(size_t index, T&& value) noexcept
-				:_index(index), _value(std::forward<T>(value))
-			{}
-			size_t _index;
-			V _value;
-		};
-		template<typename V>
-		item_pair(size_t, V&&)->item_pair<V>;
+		using iterator_concept = std::conditional_t<std::ranges::random_access_range<MaybeConst<Const>>,
+			std::random_access_iterator_tag, std::conditional_t<std::ranges::bidirectional_range<MaybeConst<Const>>,
+			std::bidirectional_iterator_tag, std::conditional_t<std::ranges::forward_range<MaybeConst<Const>>,
+			std::forward_iterator_tag, std::input_iterator_tag>>>;
+		using iterator_category = std::input_iterator_tag; // items are yielded by value
+		using difference_type = std::ranges::range_difference_t<MaybeConst<Const>>;
+		using reference = item_pair<std::ranges::range_reference_t<MaybeConst<Const>>>;
+		using value_type = reference;
+		LOOP_PROFILE_PROBE
 
 	public:
-		constexpr enumerate_iterator(size_t index, Iter iter) noexcept
-			:_index(index), _iter(iter)
+		enumerate_iterator() requires std::default_initializable<Iter> = default;
+		constexpr enumerate_iterator(Iter iter, difference_type index) noexcept
+			:_iter(std::move(iter)), _index(index)
+		{}
+		constexpr enumerate_iterator(enumerate_iterator<!Const> other) noexcept
+			requires Const && std::convertible_to<std::ranges::iterator_t<Base>, Iter>
+			:_iter(std::move(other._iter)), _index(other._index)
 		{}
-		constexpr auto operator*() const noexcept {
-			return item_pair(_index, *_iter);
+
+		constexpr reference operator*() const noexcept {
+			return reference(static_cast<size_t>(_index), *_iter);
+		}
+		constexpr reference operator[](difference_type n) const noexcept
+			requires std::ranges::random_access_range<MaybeConst<Const>> {
+			return reference(static_cast<size_t>(_index + n), _iter[n]);
 		}
 		constexpr enumerate_iterator& operator++() noexcept {
 			++_index;
 			++_iter;
+			LOOP_PROFILE_STEP(1);
 			return *this;
 		}
-		constexpr enumerate_iterator operator++(int) noexcept {
+		constexpr void operator++(int) noexcept {
+			++*this;
+		}
+		constexpr enumerate_iterator operator++(int) noexcept
+			requires std::ranges::forward_range<MaybeConst<Const>> {
 			enumerate_iterator tmp = *this;
-			this->operator++();
+			++*this;
 			return tmp;
 		}
-		constexpr bool operator==(const enumerate_iterator& rhs) const noexcept {
-			return this->_iter == rhs._iter;
+		constexpr enumerate_iterator& operator--() noexcept
+			requires std::ranges::bidirectional_range<MaybeConst<Const>> {
+			--_index;
+			--_iter;
+			return *this;
+		}
+		constexpr enumerate_iterator operator--(int) noexcept
+			requires std::ranges::bidirectional_range<MaybeConst<Const>> {
+			enumerate_iterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+		constexpr enumerate_iterator& operator+=(difference_type n) noexcept
+			requires std::ranges::random_access_range<MaybeConst<Const>> {
+			_index += n;
+			_iter += n;
+			LOOP_PROFILE_STEP(n);
+			return *this;
+		}
+		constexpr enumerate_iterator& operator-=(difference_type n) noexcept
+			requires std::ranges::random_access_range<MaybeConst<Const>> {
+			return *this += -n;
+		}
+		friend constexpr enumerate_iterator operator+(enumerate_iterator it, difference_type n) noexcept
+			requires std::ranges::random_access_range<MaybeConst<Const>> {
+			return it += n;
+		}
+		friend constexpr enumerate_iterator operator+(difference_type n, enumerate_iterator it) noexcept
+			requires std::ranges::random_access_range<MaybeConst<Const>> {
+			return it += n;
 		}
-		constexpr bool operator!=(const enumerate_iterator& rhs) const noexcept {
-			return !(*this == rhs);
+		friend constexpr enumerate_iterator operator-(enumerate_iterator it, difference_type n) noexcept
+			requires std::ranges::random_access_range<MaybeConst<Const>> {
+			return it -= n;
+		}
+		friend constexpr difference_type operator-(const enumerate_iterator& lhs, const enumerate_iterator& rhs) noexcept {
+			return lhs._index - rhs._index;
+		}
+		// the index follows the position, so comparing either is enough
+		friend constexpr bool operator==(const enumerate_iterator& lhs, const enumerate_iterator& rhs) noexcept {
+			return lhs._index == rhs._index;
+		}
+		friend constexpr auto operator<=>(const enumerate_iterator& lhs, const enumerate_iterator& rhs) noexcept {
+			return lhs._index <=> rhs._index;
+		}
+
+		constexpr const Iter& base() const& noexcept {
+			return _iter;
+		}
+		constexpr size_t index() const noexcept {
+			return static_cast<size_t>(_index);
 		}
 
 	private:
-		size_t _index = 0;
-		Iter _iter;
+		Iter _iter = Iter();
+		difference_type _index = 0;
+	};
+
+	// the end of the underlying range, so no size is needed to stop
+	template<bool Const>
+	class enumerate_sentinel
+	{
+		using Sent = std::ranges::sentinel_t<MaybeConst<Const>>;
+
+	public:
+		enumerate_sentinel() = default;
+		constexpr explicit enumerate_sentinel(Sent end) noexcept
+			:_end(std::move(end))
+		{}
+		friend constexpr bool operator==(const enumerate_iterator<Const>& lhs, const enumerate_sentinel& rhs) noexcept {
+			return lhs.base() == rhs._end;
+		}
+
+	private:
+		Sent _end = Sent();
 	};
 
 public:
+	enumerate() requires std::default_initializable<Base> = default;
 	template<typename T>
-	constexpr enumerate(T&& container) noexcept
-		:_container(std::forward<T>(container))
+	constexpr enumerate(T&& container LOOP_PROFILE_CALLER) noexcept
+		:_container(std::views::all(std::forward<T>(container))) LOOP_PROFILE_INIT
 	{}
 	template<typename T>
-	constexpr enumerate(std::initializer_list<T> container) noexcept
-		:_container(container)
+	constexpr enumerate(std::initializer_list<T> container LOOP_PROFILE_CALLER) noexcept
+		:_container(container) LOOP_PROFILE_INIT
 	{}
 	constexpr auto begin() noexcept {
-		return enumerate_iterator(0, _container.begin());
+		enumerate_iterator<false> first(std::ranges::begin(_container), 0);
+		LOOP_PROFILE_START(first, "enumerate", loop_site_);
+		return first;
 	}
-	constexpr auto begin() const noexcept {
-		return enumerate_iterator(0, _container.begin());
+	constexpr auto begin() const noexcept requires std::ranges::range<const Base> {
+		enumerate_iterator<true> first(std::ranges::begin(_container), 0);
+		LOOP_PROFILE_START(first, "enumerate", loop_site_);
+		return first;
 	}
 	constexpr auto end() noexcept {
-		return enumerate_iterator(_container.size(), _container.end());
+		return end_of<false>(_container);
+	}
+	constexpr auto end() const noexcept requires std::ranges::range<const Base> {
+		return end_of<true>(_container);
+	}
+	constexpr auto size() noexcept requires std::ranges::sized_range<Base> {
+		return std::ranges::size(_container);
+	}
+	constexpr auto size() const noexcept requires std::ranges::sized_range<const Base> {
+		return std::ranges::size(_container);
 	}
-	constexpr auto end() const noexcept {
-		return enumerate_iterator(_container.size(), _container.end());
+	constexpr Base base() const& noexcept requires std::copy_constructible<Base> {
+		return _container;
 	}
 
 private:
-	Container _container;
+	template<bool Const, typename Parent>
+	static constexpr auto end_of(Parent& container) noexcept
+	{
+		// stay a common range when the index of the end is known without walking
+		if constexpr (std::ranges::common_range<Parent> && std::ranges::sized_range<Parent>)
+			return enumerate_iterator<Const>(std::ranges::end(container),
+											 static_cast<std::ranges::range_difference_t<Parent>>(std::ranges::size(container)));
+		else
+			return enumerate_sentinel<Const>(std::ranges::end(container));
+	}
+
+	Base _container;
+	LOOP_PROFILE_SITE
 };
 
 template<typename T>
 enumerate(std::initializer_list<T>)->enumerate<std::initializer_list<T>>;
 template<typename T>
-enumerate(T&&)->enumerate<T>;
\ No newline at end of file
+enumerate(T&&)->enumerate<T>;
+
+template<typename Container>
+inline constexpr bool std::ranges::enable_borrowed_range<enumerate<Container>> =
+	std::is_lvalue_reference_v<Container> || std::ranges::enable_borrowed_range<std::remove_cvref_t<Container>>;
@@ -0,0 +1,244 @@
+﻿#pragma once
+
+#include "range.h"
+#include "../ThreadPool/thread_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * How a parallel loop is split: the index space is cut into chunks of grain
+ * indices. Dynamic scheduling lets idle workers steal half of the chunks left
+ * to another one, static scheduling hands every worker a fixed contiguous
+ * block of chunks, so the same indices always run on the same worker.
+ * Partial results are combined per chunk in index order either way, so a
+ * reduction gives the same result on every run for a given grain.
+ */
+class parallel_policy
+{
+public:
+	constexpr parallel_policy(bool deterministic = false, size_t grain = 0, thread_pool* pool = nullptr) noexcept
+		: deterministic_(deterministic), grain_(grain), pool_(pool)
+	{}
+	// run on the given pool instead of the global one
+	constexpr parallel_policy on(thread_pool& pool) const noexcept
+	{
+		return parallel_policy(deterministic_, grain_, &pool);
+	}
+	// indices per chunk, 0 picks one so that each worker gets several chunks
+	constexpr parallel_policy grain(size_t grain) const noexcept
+	{
+		return parallel_policy(deterministic_, grain, pool_);
+	}
+	constexpr bool deterministic() const noexcept { return deterministic_; }
+	constexpr size_t grain() const noexcept { return grain_; }
+	thread_pool& pool() const noexcept { return pool_ ? *pool_ : thread_pool::global(); }
+
+private:
+	bool deterministic_;
+	size_t grain_;
+	thread_pool* pool_;
+};
+
+inline constexpr parallel_policy par{};
+inline constexpr parallel_policy par_static{ true };
+
+namespace detail {
+	// chunks [begin, end) left to a worker, padded to keep workers off each other's cache lines
+	struct alignas(64) ChunkQueue
+	{
+		std::mutex lock;
+		size_t begin = 0;
+		size_t end = 0;
+
+		bool pop(size_t& chunk)
+		{
+			std::lock_guard guard(lock);
+			if (begin == end)
+				return false;
+			chunk = begin++;
+			return true;
+		}
+		// take the upper half of the victim's chunks, the first of them is returned
+		bool steal_from(ChunkQueue& victim, size_t& chunk)
+		{
+			size_t first, last;
+			{
+				std::lock_guard guard(victim.lock);
+				if (victim.begin == victim.end)
+					return false;
+				last = victim.end;
+				first = victim.begin + (victim.end - victim.begin) / 2;
+				victim.end = first;
+			}
+			std::lock_guard guard(lock);
+			begin = first + 1;
+			end = last;
+			chunk = first;
+			return true;
+		}
+	};
+
+	// call chunk_body(worker, chunk) for every chunk in [0, chunks) on the workers of the pool
+	template<typename F>
+	void ScheduleChunks(size_t chunks, const parallel_policy& policy, F&& chunk_body)
+	{
+		auto& pool = policy.pool();
+		const size_t workers = std::min(pool.size(), chunks);
+		std::unique_ptr<ChunkQueue[]> queues(new ChunkQueue[workers]);
+		for (size_t w = 0; w < workers; w++)
+		{
+			queues[w].begin = chunks * w / workers;
+			queues[w].end = chunks * (w + 1) / workers;
+		}
+		pool.run([&](size_t id) {
+			if (id >= workers)
+				return;
+			auto& own = queues[id];
+			size_t chunk;
+			while (true)
+			{
+				while (own.pop(chunk))
+					chunk_body(id, chunk);
+				if (policy.deterministic())
+					return;
+				bool stolen = false;
+				for (size_t i = 1; i < workers && !stolen; i++)
+					stolen = own.steal_from(queues[(id + i) % workers], chunk);
+				if (!stolen)
+					return;
+				chunk_body(id, chunk);
+			}
+		});
+	}
+
+	// splits a random access range into chunks of the grain of the policy
+	template<typename R>
+	class Chunks
+	{
+	public:
+		Chunks(R& items, const parallel_policy& policy) noexcept
+			: first_(std::ranges::begin(items))
+			, count_(static_cast<size_t>(std::ranges::size(items)))
+		{
+			constexpr size_t ChunksPerWorker = 8;
+			grain_ = policy.grain() != 0 ? policy.grain()
+				: std::max<size_t>(count_ / (policy.pool().size() * ChunksPerWorker), 1);
+		}
+		size_t size() const noexcept
+		{
+			return (count_ + grain_ - 1) / grain_;
+		}
+		auto operator[](size_t chunk) const noexcept
+		{
+			using Difference = std::ranges::range_difference_t<R>;
+			auto first = first_ + static_cast<Difference>(chunk * grain_);
+			return std::pair(first, first + static_cast<Difference>(std::min(grain_, count_ - chunk * grain_)));
+		}
+
+	private:
+		std::ranges::iterator_t<R> first_;
+		size_t count_;
+		size_t grain_;
+	};
+
+	// fn(args..., item), or fn(args..., index, value) for the items of enumerate
+	template<typename F, typename Item, typename... Args>
+	decltype(auto) InvokeItem(F& fn, Item&& item, Args&... args)
+	{
+		if constexpr (std::is_invocable_v<F&, Args&..., Item>)
+			return fn(args..., std::forward<Item>(item));
+		else
+		{
+			auto&& [index, value] = item;
+			return fn(args..., index, value);
+		}
+	}
+}
+
+template<typename R>
+concept parallel_range = std::ranges::random_access_range<R> && std::ranges::sized_range<R>;
+
+/*
+ * for_each(range(0, n, step), fn, par) - runs fn(i) for every index in parallel,
+ * for_each(enumerate(v), fn, par) runs fn(index, value) for every element.
+ * Any sized random access range can be split this way. If fn returns a value,
+ * the results are combined with op (operator+ by default) in a tree over the
+ * chunks and returned, otherwise nothing is returned.
+ */
+template<parallel_range R, typename F, typename Op>
+auto for_each(R&& items, F&& fn, Op&& op, const parallel_policy& policy)
+{
+	using Result = std::decay_t<decltype(detail::InvokeItem(fn, *std::ranges::begin(items)))>;
+	const detail::Chunks<std::remove_reference_t<R>> chunks(items, policy);
+
+	if constexpr (std::is_void_v<Result>)
+	{
+		detail::ScheduleChunks(chunks.size(), policy, [&](size_t, size_t chunk) {
+			for (auto [it, last] = chunks[chunk]; it != last; ++it)
+				detail::InvokeItem(fn, *it);
+		});
+	}
+	else
+	{
+		std::vector<std::optional<Result>> partials(chunks.size());
+		detail::ScheduleChunks(chunks.size(), policy, [&](size_t, size_t chunk) {
+			auto [it, last] = chunks[chunk];
+			Result partial = detail::InvokeItem(fn, *it);
+			while (++it != last)
+				partial = op(std::move(partial), detail::InvokeItem(fn, *it));
+			partials[chunk].emplace(std::move(partial));
+		});
+		// pairwise over neighbouring chunks, which keeps the order of combination fixed
+		for (size_t stride = 1; stride < partials.size(); stride *= 2)
+		{
+			for (size_t i = 0; i + stride < partials.size(); i += stride * 2)
+				*partials[i] = op(std::move(*partials[i]), std::move(*partials[i + stride]));
+		}
+		return !partials.empty() ? std::move(*partials[0]) : Result{};
+	}
+}
+
+template<parallel_range R, typename F>
+auto for_each(R&& items, F&& fn, const parallel_policy& policy)
+{
+	return for_each(std::forward<R>(items), std::forward<F>(fn), std::plus<>{}, policy);
+}
+
+/*
+ * accumulate(enumerate(v), init, fn, merge, par) - every worker accumulates
+ * into its own value-initialised T with fn(acc, item) (or fn(acc, index,
+ * value)), so T{} must be the identity of merge. The workers' results are
+ * then merged into init once, in worker order. Only the static schedule makes
+ * the split between workers, and so the result, reproducible.
+ */
+template<parallel_range R, typename T, typename F, typename Merge>
+T accumulate(R&& items, T init, F&& fn, Merge&& merge, const parallel_policy& policy)
+{
+	struct alignas(64) Local // one cache line each, the workers write them all the time
+	{
+		std::optional<T> value;
+	};
+	const detail::Chunks<std::remove_reference_t<R>> chunks(items, policy);
+	std::vector<Local> locals(policy.pool().size());
+	detail::ScheduleChunks(chunks.size(), policy, [&](size_t worker, size_t chunk) {
+		auto& local = locals[worker].value;
+		if (!local)
+			local.emplace();
+		for (auto [it, last] = chunks[chunk]; it != last; ++it)
+			detail::InvokeItem(fn, *it, *local);
+	});
+	for (auto& local : locals)
+	{
+		if (local.value)
+			init = merge(std::move(init), std::move(*local.value));
+	}
+	return init;
+}
@@ -3,67 +3,158 @@
 #include <type_traits>
 #include <concepts>
 #include <cassert>
+#include <cstddef>
+#include <compare>
+#include <iterator>
+#include <ranges>
+
+// loop hooks, no-ops unless LoopProfiler.h was included first with LOOP_PROFILE
+#ifndef LOOP_PROFILE_HOOKS
+#define LOOP_PROFILE_HOOKS
+#define LOOP_PROFILE_CALLER
+#define LOOP_PROFILE_ONLY_CALLER
+#define LOOP_PROFILE_INIT
+#define LOOP_PROFILE_SITE
+#define LOOP_PROFILE_PROBE
+#define LOOP_PROFILE_START(iterator, kind, where) static_cast<void>(0)
+#define LOOP_PROFILE_STEP(count) static_cast<void>(0)
+#endif
 
 template<std::integral T>
-class range
+class range : public std::ranges::view_interface<range<T>>
 {
 public:
 	using difference_type = std::make_signed_t<T>;
+	using size_type = std::make_unsigned_t<T>;
 	using value_type = T;
 
+	// counts steps from the first value, so it's a plain induction variable
 	class range_iterator
 	{
 	public:
-		using difference_type = range::difference_type;
+		using difference_type = std::common_type_t<std::ptrdiff_t, range::difference_type>;
 		using value_type = range::value_type;
+		using reference = value_type;
+		using iterator_concept = std::random_access_iterator_tag;
+		// values are yielded by value, yet claim random access so that
+		// parallel algorithms split the range instead of walking it
+		using iterator_category = std::random_access_iterator_tag;
+		LOOP_PROFILE_PROBE
 	public:
 		constexpr range_iterator() = default;
-		constexpr range_iterator(value_type pos, difference_type step) noexcept
-			: pos_(pos), step_(step)
+		constexpr range_iterator(value_type first, range::difference_type step, difference_type index) noexcept
+			: first_(first), step_(step), index_(index)
 		{}
-		constexpr value_type operator*() const noexcept { return pos_; }
-		constexpr range_iterator& operator++() noexcept { pos_ += step_; return *this; }
+		constexpr value_type operator*() const noexcept { return at(index_); }
+		constexpr value_type operator[](difference_type n) const noexcept { return at(index_ + n); }
+		constexpr range_iterator& operator++() noexcept { ++index_; LOOP_PROFILE_STEP(1); return *this; }
 		constexpr range_iterator operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
-		constexpr range_iterator& operator--() noexcept { pos_ -= step_; return *this; }
-		constexpr range_iterator operator--(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+		constexpr range_iterator& operator--() noexcept { --index_; return *this; }
+		constexpr range_iterator operator--(int) noexcept { auto tmp = *this; --*this; return tmp; }
+		constexpr range_iterator& operator+=(difference_type n) noexcept { index_ += n; LOOP_PROFILE_STEP(n); return *this; }
+		constexpr range_iterator& operator-=(difference_type n) noexcept { index_ -= n; return *this; }
+		friend constexpr range_iterator operator+(range_iterator it, difference_type n) noexcept { return it += n; }
+		friend constexpr range_iterator operator+(difference_type n, range_iterator it) noexcept { return it += n; }
+		friend constexpr range_iterator operator-(range_iterator it, difference_type n) noexcept { return it -= n; }
+		friend constexpr difference_type operator-(const range_iterator& lhs, const range_iterator& rhs) noexcept
+		{
+			return lhs.index_ - rhs.index_;
+		}
 		constexpr bool operator==(const range_iterator& rhs) const noexcept
 		{
-			return this->pos_ == rhs.pos_;
+			return this->index_ == rhs.index_;
+		}
+		constexpr auto operator<=>(const range_iterator& rhs) const noexcept
+		{
+			return this->index_ <=> rhs.index_;
 		}
 	private:
-		value_type pos_ = value_type{ 0 };
-		difference_type step_ = difference_type{ 1 };
+		constexpr value_type at(difference_type index) const noexcept
+		{
+			// wrap around in unsigned arithmetic, the result itself is always in range
+			using Unsigned = std::make_unsigned_t<difference_type>;
+			return static_cast<value_type>(static_cast<Unsigned>(first_) +
+										   static_cast<Unsigned>(index * step_));
+		}
+		value_type first_ = value_type{ 0 };
+		range::difference_type step_ = range::difference_type{ 1 };
+		difference_type index_ = difference_type{ 0 };
 	};
 
 	template<typename V>
-	constexpr range(V end) noexcept
-		: end_(static_cast<value_type>(end))
+	constexpr range(V end LOOP_PROFILE_CALLER) noexcept
+		: end_(static_cast<value_type>(end)) LOOP_PROFILE_INIT
 	{
 		check();
 	}
 	template<typename U, typename V>
-	constexpr range(U begin, V end) noexcept
-		: begin_(static_cast<value_type>(begin)), end_(static_cast<value_type>(end))
+	constexpr range(U begin, V end LOOP_PROFILE_CALLER) noexcept
+		: begin_(static_cast<value_type>(begin)), end_(static_cast<value_type>(end)) LOOP_PROFILE_INIT
 	{
 		check();
 	}
 	template<typename U, typename V, typename W>
-	constexpr range(U begin, V end, W step) noexcept
+	constexpr range(U begin, V end, W step LOOP_PROFILE_CALLER) noexcept
 		: begin_(static_cast<value_type>(begin)), end_(static_cast<value_type>(end))
-		, step_(static_cast<difference_type>(step))
+		, step_(static_cast<difference_type>(step)) LOOP_PROFILE_INIT
 	{
 		check();
 	}
 	constexpr auto begin() const noexcept
 	{
-		return range_iterator(begin_, step_);
+		range_iterator first(begin_, step_, 0);
+		LOOP_PROFILE_START(first, "range", loop_site_);
+		return first;
 	}
 	constexpr auto end() const noexcept
 	{
-		return range_iterator(end_, step_);
+		// the end is one step past the last value, so any step terminates
+		return range_iterator(begin_, step_, static_cast<typename range_iterator::difference_type>(size()));
+	}
+	constexpr size_type size() const noexcept
+	{
+		if (step_ > difference_type{ 0 } && begin_ < end_)
+			return count_steps(span(begin_, end_), stride());
+		if (step_ < difference_type{ 0 } && begin_ > end_)
+			return count_steps(span(end_, begin_), stride());
+		return size_type{ 0 };
+	}
+
+	// closed forms instead of walking the sequence
+	constexpr bool contains(value_type value) const noexcept
+	{
+		if (step_ > difference_type{ 0 })
+			return begin_ <= value && value < end_ && span(begin_, value) % stride() == 0;
+		else
+			return end_ < value && value <= begin_ && span(value, begin_) % stride() == 0;
+	}
+	constexpr size_type count(value_type value) const noexcept
+	{
+		return contains(value) ? size_type{ 1 } : size_type{ 0 };
+	}
+	template<typename R = std::common_type_t<value_type, long long>>
+	constexpr R sum() const noexcept
+	{
+		// n * begin + step * n * (n - 1) / 2, halving whichever factor is even
+		const R n = static_cast<R>(size());
+		const R triangle = n % 2 == 0 ? n / 2 * (n - 1) : (n - 1) / 2 * n;
+		return n * static_cast<R>(begin_) + static_cast<R>(step_) * triangle;
 	}
 
 private:
+	static constexpr size_type span(value_type low, value_type high) noexcept
+	{
+		return static_cast<size_type>(static_cast<size_type>(high) - static_cast<size_type>(low));
+	}
+	constexpr size_type stride() const noexcept
+	{
+		const auto step = static_cast<size_type>(step_);
+		return step_ > difference_type{ 0 } ? step : static_cast<size_type>(size_type{ 0 } - step);
+	}
+	static constexpr size_type count_steps(size_type distance, size_type stride) noexcept
+	{
+		return distance / stride + (distance % stride != 0);
+	}
 	constexpr void check() noexcept
 	{
 		if (std::is_constant_evaluated())
@@ -82,6 +173,7 @@ private:
 	value_type begin_ = value_type{ 0 };
 	value_type end_;
 	difference_type step_ = difference_type{ 1 };
+	LOOP_PROFILE_SITE
 };
 
 template<typename V>
@@ -89,4 +181,7 @@ range(V) -> range<V>;
 template<typename U, typename V>
 range(U, V) -> range<V>;
 template<typename U, typename V, typename W>
-range(U, V, W) -> range<V>;
\ No newline at end of file
+range(U, V, W) -> range<V>;
+
+template<typename T>
+inline constexpr bool std::ranges::enable_borrowed_range<range<T>> = true;
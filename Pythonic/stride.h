@@ -0,0 +1,118 @@
+﻿#pragma once
+
+#include <utility>
+#include <iterator>
+#include <ranges>
+#include <type_traits>
+#include <compare>
+#include <cstddef>
+#include <cassert>
+
+// stride(v, k) - every k-th element, starting from the first one
+template<typename Container>
+class stride : public std::ranges::view_interface<stride<Container>>
+{
+	using Base = std::views::all_t<Container>;
+	template<bool Const>
+	using MaybeConst = std::conditional_t<Const, const Base, Base>;
+
+	static_assert(std::ranges::random_access_range<Base> && std::ranges::sized_range<Base>,
+				  "stride needs a sized random access range.");
+
+public:
+	// counts elements and scales by the step on access, so it never steps past the end
+	template<bool Const>
+	class stride_iterator
+	{
+		using Iter = std::ranges::iterator_t<MaybeConst<Const>>;
+		friend class stride_iterator<!Const>;
+
+	public:
+		using iterator_concept = std::random_access_iterator_tag;
+		using iterator_category = std::conditional_t<std::is_lvalue_reference_v<std::ranges::range_reference_t<MaybeConst<Const>>>,
+			std::random_access_iterator_tag, std::input_iterator_tag>;
+		using difference_type = std::ranges::range_difference_t<MaybeConst<Const>>;
+		using value_type = std::ranges::range_value_t<MaybeConst<Const>>;
+		using reference = std::ranges::range_reference_t<MaybeConst<Const>>;
+
+	public:
+		stride_iterator() = default;
+		constexpr stride_iterator(Iter first, difference_type index, difference_type step) noexcept
+			:_first(std::move(first)), _index(index), _step(step)
+		{}
+		constexpr stride_iterator(stride_iterator<!Const> other) noexcept
+			requires Const && std::convertible_to<std::ranges::iterator_t<Base>, Iter>
+			:_first(std::move(other._first)), _index(other._index), _step(other._step)
+		{}
+
+		constexpr reference operator*() const noexcept { return _first[_index * _step]; }
+		constexpr reference operator[](difference_type n) const noexcept { return _first[(_index + n) * _step]; }
+		constexpr stride_iterator& operator++() noexcept { ++_index; return *this; }
+		constexpr stride_iterator operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+		constexpr stride_iterator& operator--() noexcept { --_index; return *this; }
+		constexpr stride_iterator operator--(int) noexcept { auto tmp = *this; --*this; return tmp; }
+		constexpr stride_iterator& operator+=(difference_type n) noexcept { _index += n; return *this; }
+		constexpr stride_iterator& operator-=(difference_type n) noexcept { _index -= n; return *this; }
+		friend constexpr stride_iterator operator+(stride_iterator it, difference_type n) noexcept { return it += n; }
+		friend constexpr stride_iterator operator+(difference_type n, stride_iterator it) noexcept { return it += n; }
+		friend constexpr stride_iterator operator-(stride_iterator it, difference_type n) noexcept { return it -= n; }
+		friend constexpr difference_type operator-(const stride_iterator& lhs, const stride_iterator& rhs) noexcept {
+			return lhs._index - rhs._index;
+		}
+		friend constexpr bool operator==(const stride_iterator& lhs, const stride_iterator& rhs) noexcept {
+			return lhs._index == rhs._index;
+		}
+		friend constexpr auto operator<=>(const stride_iterator& lhs, const stride_iterator& rhs) noexcept {
+			return lhs._index <=> rhs._index;
+		}
+
+	private:
+		Iter _first = Iter();
+		difference_type _index = 0;
+		difference_type _step = 1;
+	};
+
+public:
+	stride() requires std::default_initializable<Base> = default;
+	template<typename T>
+	constexpr stride(T&& container, size_t step) noexcept
+		:_container(std::views::all(std::forward<T>(container))), _step(step)
+	{
+		assert(step > 0);
+	}
+	constexpr auto begin() noexcept {
+		return iterator_at<false>(_container, 0);
+	}
+	constexpr auto begin() const noexcept requires std::ranges::random_access_range<const Base> {
+		return iterator_at<true>(_container, 0);
+	}
+	constexpr auto end() noexcept {
+		return iterator_at<false>(_container, size());
+	}
+	constexpr auto end() const noexcept requires std::ranges::random_access_range<const Base> {
+		return iterator_at<true>(_container, size());
+	}
+	constexpr size_t size() const noexcept {
+		const auto count = static_cast<size_t>(std::ranges::size(_container));
+		return (count + _step - 1) / _step;
+	}
+
+private:
+	template<bool Const, typename Parent>
+	constexpr auto iterator_at(Parent& container, size_t index) const noexcept
+	{
+		using Difference = std::ranges::range_difference_t<Parent>;
+		return stride_iterator<Const>(std::ranges::begin(container), static_cast<Difference>(index),
+									  static_cast<Difference>(_step));
+	}
+
+	Base _container;
+	size_t _step = 1;
+};
+
+template<typename T>
+stride(T&&, size_t)->stride<T>;
+
+template<typename Container>
+inline constexpr bool std::ranges::enable_borrowed_range<stride<Container>> =
+	std::is_lvalue_reference_v<Container> || std::ranges::enable_borrowed_range<std::remove_cvref_t<Container>>;
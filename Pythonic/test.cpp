@@ -1,8 +1,13 @@
 ﻿#include "range.h"
 #include "enumerate.h"
+#include "parallel.h"
+#include "zip.h"
+#include "chunked.h"
+#include "stride.h"
 
 #include <iostream>
 #include <vector>
+#include <string_view>
 
 int main(int argc, char* argv[])
 {
@@ -18,6 +23,19 @@ int main(int argc, char* argv[])
 		std::cout << i << ' '; // 5 3 1 -1 -3
 	std::cout << std::endl;
 
+	for (auto&& i : range(0, 5, 2))
+		std::cout << i << ' '; // 0 2 4
+	std::cout << std::endl;
+
+	static_assert(std::ranges::random_access_range<range<int>> && std::ranges::sized_range<range<int>>);
+	constexpr auto r = range(0, 10, 3);
+	std::cout << r.size() << ' ' << r.sum() << ' ' << r.contains(9) << ' ' << r.contains(4) << ' ' << r[2]; // 4 18 1 0 6
+	std::cout << std::endl;
+
+	std::cout << for_each(range(0, 100, 3), [](int i) { return i; }, par) << ' '; // 1683
+	std::cout << for_each(range(1, 11), [](int i) { return i; }, std::multiplies<>{}, par_static.grain(2)); // 3628800
+	std::cout << std::endl;
+
 	auto list = { 21,42 };
 	for (auto&& [index, value] : enumerate(list))
 		std::cout << index << ":" << value << ' '; // 0:21 1:42
@@ -33,6 +51,40 @@ int main(int argc, char* argv[])
 		std::cout << index << ":" << value << ' ';
 	std::cout << std::endl;
 
+	for (auto [index, value] : enumerate(v))
+		value *= 10; // items refer to the elements
+	static_assert(std::ranges::random_access_range<decltype(enumerate(v))>);
+	for (auto&& [index, value] : enumerate(v) | std::views::reverse)
+		std::cout << index << ":" << value << ' '; // 2:40 1:30 0:20
+	std::cout << std::endl;
+
+	for_each(enumerate(v), [](size_t index, int& value) { value += static_cast<int>(index); }, par);
+	auto odd = accumulate(enumerate(v), 0, [](int& count, size_t, int value) { count += value % 2; },
+						  std::plus<>{}, par_static);
+	std::cout << v[0] << ' ' << v[1] << ' ' << v[2] << ' ' << odd; // 20 31 42 1
+	std::cout << std::endl;
+
+	// init is counted once, however many workers take part
+	thread_pool four(4);
+	std::vector<int> ones(1000, 1);
+	std::cout << accumulate(ones, 100, [](int& sum, int value) { sum += value; }, std::plus<>{}, par.on(four)) << ' '
+			  << accumulate(ones, 100, [](int& sum, int value) { sum += value; }, std::plus<>{}, par_static.on(four));
+	std::cout << std::endl; // 1100 1100
+
+	std::vector<char> letters{ 'a','b','c','d','e' };
+	for (auto&& [index, pair] : enumerate(zip(v, letters)))
+	{
+		auto&& [value, letter] = pair;
+		std::cout << index << ":" << value << letter << ' '; // 0:20a 1:31b 2:42c
+	}
+	std::cout << std::endl;
+
+	for (auto chunk : chunked(letters, 2))
+		std::cout << std::string_view(chunk.data(), chunk.size()) << ' '; // ab cd e
+	for (auto letter : stride(letters, 2))
+		std::cout << letter; // ace
+	std::cout << std::endl;
+
 	const std::vector<int> cv{ 2,3,4 };
 	for (auto&& [index, value] : enumerate(cv))
 		std::cout << index << ":" << value << ' ';
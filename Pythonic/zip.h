@@ -0,0 +1,199 @@
+﻿#pragma once
+
+#include <utility>
+#include <iterator>
+#include <ranges>
+#include <tuple>
+#include <type_traits>
+#include <concepts>
+#include <compare>
+#include <cstddef>
+#include <algorithm>
+
+template<typename... Containers>
+class zip : public std::ranges::view_interface<zip<Containers...>>
+{
+	static_assert(sizeof...(Containers) > 0, "zip needs at least one range.");
+
+	template<bool Const, typename Container>
+	using MaybeConst = std::conditional_t<Const, const std::views::all_t<Container>, std::views::all_t<Container>>;
+	template<bool Const>
+	static constexpr bool AllRandomAccess = (std::ranges::random_access_range<MaybeConst<Const, Containers>> && ...);
+	template<bool Const>
+	static constexpr bool AllBidirectional = (std::ranges::bidirectional_range<MaybeConst<Const, Containers>> && ...);
+	template<bool Const>
+	static constexpr bool AllForward = (std::ranges::forward_range<MaybeConst<Const, Containers>> && ...);
+
+public:
+	template<bool Const>
+	class zip_iterator
+	{
+		using Iters = std::tuple<std::ranges::iterator_t<MaybeConst<Const, Containers>>...>;
+		friend class zip_iterator<!Const>;
+
+	public:
+		using iterator_concept = std::conditional_t<AllRandomAccess<Const>, std::random_access_iterator_tag,
+			std::conditional_t<AllBidirectional<Const>, std::bidirectional_iterator_tag,
+			std::conditional_t<AllForward<Const>, std::forward_iterator_tag, std::input_iterator_tag>>>;
+		using iterator_category = std::input_iterator_tag; // items are yielded by value
+		using difference_type = std::common_type_t<std::ranges::range_difference_t<MaybeConst<Const, Containers>>...>;
+		// one reference into each range, so structured bindings refer to the elements
+		using reference = std::tuple<std::ranges::range_reference_t<MaybeConst<Const, Containers>>...>;
+		using value_type = reference;
+
+	public:
+		zip_iterator() = default;
+		constexpr explicit zip_iterator(Iters iters) noexcept
+			:_iters(std::move(iters))
+		{}
+		constexpr zip_iterator(zip_iterator<!Const> other) noexcept
+			requires Const
+			:_iters(std::move(other._iters))
+		{}
+
+		constexpr reference operator*() const noexcept {
+			return std::apply([](const auto&... iters) { return reference(*iters...); }, _iters);
+		}
+		constexpr reference operator[](difference_type n) const noexcept requires AllRandomAccess<Const> {
+			return *(*this + n);
+		}
+		constexpr zip_iterator& operator++() noexcept {
+			std::apply([](auto&... iters) { (++iters, ...); }, _iters);
+			return *this;
+		}
+		constexpr void operator++(int) noexcept {
+			++*this;
+		}
+		constexpr zip_iterator operator++(int) noexcept requires AllForward<Const> {
+			zip_iterator tmp = *this;
+			++*this;
+			return tmp;
+		}
+		constexpr zip_iterator& operator--() noexcept requires AllBidirectional<Const> {
+			std::apply([](auto&... iters) { (--iters, ...); }, _iters);
+			return *this;
+		}
+		constexpr zip_iterator operator--(int) noexcept requires AllBidirectional<Const> {
+			zip_iterator tmp = *this;
+			--*this;
+			return tmp;
+		}
+		constexpr zip_iterator& operator+=(difference_type n) noexcept requires AllRandomAccess<Const> {
+			std::apply([n](auto&... iters) { ((iters += n), ...); }, _iters);
+			return *this;
+		}
+		constexpr zip_iterator& operator-=(difference_type n) noexcept requires AllRandomAccess<Const> {
+			return *this += -n;
+		}
+		friend constexpr zip_iterator operator+(zip_iterator it, difference_type n) noexcept
+			requires AllRandomAccess<Const> {
+			return it += n;
+		}
+		friend constexpr zip_iterator operator+(difference_type n, zip_iterator it) noexcept
+			requires AllRandomAccess<Const> {
+			return it += n;
+		}
+		friend constexpr zip_iterator operator-(zip_iterator it, difference_type n) noexcept
+			requires AllRandomAccess<Const> {
+			return it -= n;
+		}
+		// all iterators move in lockstep, so the first one stands for the others
+		friend constexpr difference_type operator-(const zip_iterator& lhs, const zip_iterator& rhs) noexcept
+			requires AllRandomAccess<Const> {
+			return std::get<0>(lhs._iters) - std::get<0>(rhs._iters);
+		}
+		friend constexpr bool operator==(const zip_iterator& lhs, const zip_iterator& rhs) noexcept {
+			return std::get<0>(lhs._iters) == std::get<0>(rhs._iters);
+		}
+		friend constexpr auto operator<=>(const zip_iterator& lhs, const zip_iterator& rhs) noexcept
+			requires AllRandomAccess<Const> {
+			return std::get<0>(lhs._iters) <=> std::get<0>(rhs._iters);
+		}
+
+		constexpr const Iters& base() const& noexcept {
+			return _iters;
+		}
+
+	private:
+		Iters _iters;
+	};
+
+	// the ends of all ranges, the zip stops as soon as any of them is reached
+	template<bool Const>
+	class zip_sentinel
+	{
+		using Sents = std::tuple<std::ranges::sentinel_t<MaybeConst<Const, Containers>>...>;
+
+	public:
+		zip_sentinel() = default;
+		constexpr explicit zip_sentinel(Sents ends) noexcept
+			:_ends(std::move(ends))
+		{}
+		friend constexpr bool operator==(const zip_iterator<Const>& lhs, const zip_sentinel& rhs) noexcept {
+			return [&]<size_t... I>(std::index_sequence<I...>) {
+				return ((std::get<I>(lhs.base()) == std::get<I>(rhs._ends)) || ...);
+			}(std::index_sequence_for<Containers...>{});
+		}
+
+	private:
+		Sents _ends;
+	};
+
+public:
+	zip() = default;
+	template<typename... Ts>
+		requires (sizeof...(Ts) == sizeof...(Containers))
+	constexpr explicit zip(Ts&&... containers) noexcept
+		:_containers(std::views::all(std::forward<Ts>(containers))...)
+	{}
+	constexpr auto begin() noexcept {
+		return begin_of<false>(_containers);
+	}
+	constexpr auto begin() const noexcept requires (std::ranges::range<const std::views::all_t<Containers>> && ...) {
+		return begin_of<true>(_containers);
+	}
+	constexpr auto end() noexcept {
+		return end_of<false>(*this, _containers);
+	}
+	constexpr auto end() const noexcept requires (std::ranges::range<const std::views::all_t<Containers>> && ...) {
+		return end_of<true>(*this, _containers);
+	}
+	constexpr auto size() noexcept requires (std::ranges::sized_range<std::views::all_t<Containers>> && ...) {
+		return size_of(_containers);
+	}
+	constexpr auto size() const noexcept requires (std::ranges::sized_range<const std::views::all_t<Containers>> && ...) {
+		return size_of(_containers);
+	}
+
+private:
+	template<bool Const, typename Tuple>
+	static constexpr auto begin_of(Tuple& containers) noexcept
+	{
+		return zip_iterator<Const>(std::apply([](auto&... c) { return std::tuple(std::ranges::begin(c)...); }, containers));
+	}
+	template<typename Tuple>
+	static constexpr auto size_of(Tuple& containers) noexcept
+	{
+		return std::apply([](auto&... c) {
+			return std::min({ static_cast<std::common_type_t<std::ranges::range_size_t<decltype(c)>...>>(std::ranges::size(c))... });
+		}, containers);
+	}
+	template<bool Const, typename Self, typename Tuple>
+	static constexpr auto end_of(Self& self, Tuple& containers) noexcept
+	{
+		// the shortest length gives a common end when it's reachable in one step
+		if constexpr (AllRandomAccess<Const> && (std::ranges::sized_range<MaybeConst<Const, Containers>> && ...))
+			return begin_of<Const>(containers) + static_cast<typename zip_iterator<Const>::difference_type>(self.size());
+		else
+			return zip_sentinel<Const>(std::apply([](auto&... c) { return std::tuple(std::ranges::end(c)...); }, containers));
+	}
+
+	std::tuple<std::views::all_t<Containers>...> _containers;
+};
+
+template<typename... Ts>
+zip(Ts&&...)->zip<Ts...>;
+
+template<typename... Containers>
+inline constexpr bool std::ranges::enable_borrowed_range<zip<Containers...>> =
+	((std::is_lvalue_reference_v<Containers> || std::ranges::enable_borrowed_range<std::remove_cvref_t<Containers>>) && ...);
@@ -0,0 +1,130 @@
+﻿#pragma once
+#ifndef THREAD_POOL_HEADER_
+#define THREAD_POOL_HEADER_
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// a fixed set of threads that run one parallel loop at a time, the caller joins as worker 0
+class thread_pool
+{
+public:
+	explicit thread_pool(size_t threads = std::max(std::thread::hardware_concurrency(), 1u))
+	{
+		for (size_t id = 1; id < std::max<size_t>(threads, 1); id++)
+			workers_.emplace_back([this, id] { work(id); });
+	}
+	~thread_pool()
+	{
+		{
+			std::lock_guard lock(mutex_);
+			stop_ = true;
+		}
+		wake_.notify_all();
+		for (auto& worker : workers_)
+			worker.join();
+	}
+	thread_pool(const thread_pool&) = delete;
+	thread_pool& operator=(const thread_pool&) = delete;
+
+	size_t size() const noexcept
+	{
+		return workers_.size() + 1;
+	}
+
+	// call task(worker_id) once on every worker and wait for all of them
+	template<typename F>
+	void run(F&& task)
+	{
+		if (current() == this || workers_.empty())
+		{
+			// nested in one of our own loops, the other workers are busy
+			for (size_t id = 0; id < size(); id++)
+				task(id);
+			return;
+		}
+		std::lock_guard submit(submit_mutex_);
+		{
+			std::lock_guard lock(mutex_);
+			task_ = std::addressof(task);
+			invoke_ = [](void* ptr, size_t id) { (*static_cast<std::remove_reference_t<F>*>(ptr))(id); };
+			pending_ = workers_.size();
+			error_ = nullptr;
+			generation_++;
+		}
+		wake_.notify_all();
+		execute(0);
+		std::unique_lock lock(mutex_);
+		done_.wait(lock, [this] { return pending_ == 0; });
+		if (error_)
+			std::rethrow_exception(std::exchange(error_, nullptr));
+	}
+
+	static thread_pool& global()
+	{
+		static thread_pool pool;
+		return pool;
+	}
+
+private:
+	static thread_pool*& current() noexcept
+	{
+		thread_local thread_pool* pool = nullptr;
+		return pool;
+	}
+	void execute(size_t id) noexcept
+	{
+		current() = this;
+		try
+		{
+			invoke_(task_, id);
+		}
+		catch (...)
+		{
+			std::lock_guard lock(mutex_);
+			if (!error_)
+				error_ = std::current_exception();
+		}
+		current() = nullptr;
+	}
+	void work(size_t id)
+	{
+		size_t seen = 0;
+		while (true)
+		{
+			{
+				std::unique_lock lock(mutex_);
+				wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+				if (stop_)
+					return;
+				seen = generation_;
+			}
+			execute(id);
+			std::lock_guard lock(mutex_);
+			if (--pending_ == 0)
+				done_.notify_one();
+		}
+	}
+
+	std::vector<std::thread> workers_;
+	std::mutex submit_mutex_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	void* task_ = nullptr;
+	void (*invoke_)(void*, size_t) = nullptr;
+	size_t pending_ = 0;
+	size_t generation_ = 0;
+	std::exception_ptr error_;
+	bool stop_ = false;
+};
+
+#endif // THREAD_POOL_HEADER_
@@ -0,0 +1,208 @@
+﻿#pragma once
+
+#include "VarTypeDict.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Results of an expensive function of a fully set VarTypeDict::Values, kept
+ * up to a memory budget and evicted least recently used first. The keys are
+ * spread over shards by their hash, each with its own lock, so threads asking
+ * for different keys rarely wait on each other. A key asked for by several
+ * threads at once is computed by the first of them, the others wait for its
+ * result. Results are handed out as shared pointers and stay valid after
+ * they're evicted.
+ */
+template<typename TDict, typename TResult>
+class memo_cache
+{
+	struct Entry
+	{
+		TDict key;
+		size_t hash;
+		std::shared_future<std::shared_ptr<const TResult>> result;
+		size_t bytes = 0;
+		bool ready = false; // in flight entries are never evicted
+	};
+
+	struct alignas(64) Shard
+	{
+		std::mutex lock;
+		std::list<Entry> lru; // most recently used first
+		std::unordered_multimap<size_t, typename std::list<Entry>::iterator> index;
+		size_t bytes = 0;
+	};
+
+public:
+	explicit memo_cache(size_t max_bytes, size_t shards = 16)
+		: shards_(new Shard[std::max<size_t>(shards, 1)]), shard_count_(std::max<size_t>(shards, 1)),
+		  shard_bytes_(max_bytes / std::max<size_t>(shards, 1))
+	{}
+	memo_cache(const memo_cache&) = delete;
+	memo_cache& operator=(const memo_cache&) = delete;
+
+	// the cached result for key, or compute(key) stored and returned, exceptions are passed on and not cached
+	template<typename F>
+	std::shared_ptr<const TResult> get_or_compute(const TDict& key, F&& compute)
+	{
+		const size_t hash = key.Hash();
+		Shard& shard = shard_of(hash);
+		std::promise<std::shared_ptr<const TResult>> promise;
+		typename std::list<Entry>::iterator entry;
+		{
+			std::unique_lock guard(shard.lock);
+			if (auto found = find(shard, key, hash); found != shard.lru.end())
+			{
+				shard.lru.splice(shard.lru.begin(), shard.lru, found);
+				auto result = found->result;
+				hits_.fetch_add(1, std::memory_order_relaxed);
+				guard.unlock();
+				return result.get();
+			}
+			shard.lru.push_front(Entry{ key, hash, promise.get_future().share() });
+			entry = shard.lru.begin();
+			shard.index.emplace(hash, entry);
+			misses_.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		std::shared_ptr<const TResult> result;
+		try
+		{
+			result = std::make_shared<const TResult>(std::invoke(std::forward<F>(compute), key));
+		}
+		catch (...)
+		{
+			{
+				std::lock_guard guard(shard.lock);
+				erase(shard, entry);
+			}
+			promise.set_exception(std::current_exception());
+			throw;
+		}
+		promise.set_value(result);
+
+		std::lock_guard guard(shard.lock);
+		entry->ready = true;
+		entry->bytes = sizeof(Entry) + 4 * sizeof(void*) + key.Footprint() + NSVarTypeDict::FootprintOf(*result);
+		shard.bytes += entry->bytes;
+		evict(shard);
+		return result;
+	}
+
+	// the cached result for key, nullptr if there's none or it's still being computed
+	std::shared_ptr<const TResult> find(const TDict& key)
+	{
+		const size_t hash = key.Hash();
+		Shard& shard = shard_of(hash);
+		std::lock_guard guard(shard.lock);
+		auto found = find(shard, key, hash);
+		if (found == shard.lru.end() || !found->ready)
+			return nullptr;
+		shard.lru.splice(shard.lru.begin(), shard.lru, found);
+		return found->result.get();
+	}
+
+	// drops every finished result
+	void clear()
+	{
+		for (size_t i = 0; i < shard_count_; i++)
+		{
+			std::lock_guard guard(shards_[i].lock);
+			for (auto it = shards_[i].lru.begin(); it != shards_[i].lru.end();)
+			{
+				auto next = std::next(it);
+				if (it->ready)
+					erase(shards_[i], it);
+				it = next;
+			}
+		}
+	}
+
+	// results stored, including those still being computed
+	size_t size() const
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < shard_count_; i++)
+		{
+			std::lock_guard guard(shards_[i].lock);
+			count += shards_[i].lru.size();
+		}
+		return count;
+	}
+
+	// the estimated bytes held, at most the budget once the results in flight are done
+	size_t bytes() const
+	{
+		size_t total = 0;
+		for (size_t i = 0; i < shard_count_; i++)
+		{
+			std::lock_guard guard(shards_[i].lock);
+			total += shards_[i].bytes;
+		}
+		return total;
+	}
+
+	size_t hits() const noexcept { return hits_.load(std::memory_order_relaxed); }
+	size_t misses() const noexcept { return misses_.load(std::memory_order_relaxed); }
+
+private:
+	Shard& shard_of(size_t hash) const noexcept
+	{
+		// the low bits pick the bucket inside the shard, the high ones the shard
+		return shards_[static_cast<size_t>(static_cast<uint64_t>(hash) * 0x9e3779b97f4a7c15ULL >> 32) % shard_count_];
+	}
+
+	static typename std::list<Entry>::iterator find(Shard& shard, const TDict& key, size_t hash)
+	{
+		auto [first, last] = shard.index.equal_range(hash);
+		for (; first != last; ++first)
+		{
+			if (first->second->key == key)
+				return first->second;
+		}
+		return shard.lru.end();
+	}
+
+	static void erase(Shard& shard, typename std::list<Entry>::iterator entry)
+	{
+		auto [first, last] = shard.index.equal_range(entry->hash);
+		for (; first != last; ++first)
+		{
+			if (first->second == entry)
+			{
+				shard.index.erase(first);
+				break;
+			}
+		}
+		shard.bytes -= entry->bytes;
+		shard.lru.erase(entry);
+	}
+
+	void evict(Shard& shard) const
+	{
+		for (auto it = shard.lru.end(); shard.bytes > shard_bytes_ && it != shard.lru.begin();)
+		{
+			--it;
+			if (it->ready)
+				erase(shard, std::exchange(it, std::next(it)));
+		}
+	}
+
+	std::unique_ptr<Shard[]> shards_;
+	size_t shard_count_;
+	size_t shard_bytes_;
+	std::atomic<size_t> hits_{ 0 };
+	std::atomic<size_t> misses_{ 0 };
+};
@@ -1,6 +1,22 @@
+#pragma once
+
 #include <utility>
 #include <memory>
 #include <type_traits>
+#include <tuple>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace NSVarTypeDict{
 	struct NullParameter{};
@@ -79,6 +95,393 @@ namespace NSVarTypeDict{
 
 	template<size_t Pos, typename... TTypes>
 	using Pos2Type = typename Pos2Type_<0, Pos, TTypes...>::type;
+
+	///////////////////////////////////////////////////////
+	// A plain struct holding the values in tag order, trivially copyable when all of them are.
+	// Structured bindings see its members through get<N>.
+	template<typename... TTypes>
+	struct Aggregate
+	{
+	};
+
+	template<typename TCur>
+	struct Aggregate<TCur>
+	{
+		TCur first;
+
+		template<size_t N> auto& get() & noexcept { static_assert(N == 0); return first; }
+		template<size_t N> const auto& get() const& noexcept { static_assert(N == 0); return first; }
+		template<size_t N> auto&& get() && noexcept { static_assert(N == 0); return std::move(first); }
+	};
+
+	template<typename TCur, typename TNext, typename... TRemainTypes>
+	struct Aggregate<TCur, TNext, TRemainTypes...>
+	{
+		TCur first;
+		Aggregate<TNext, TRemainTypes...> rest;
+
+		template<size_t N> auto& get() & noexcept
+		{
+			if constexpr (N == 0) return first;
+			else return rest.template get<N - 1>();
+		}
+		template<size_t N> const auto& get() const& noexcept
+		{
+			if constexpr (N == 0) return first;
+			else return rest.template get<N - 1>();
+		}
+		template<size_t N> auto&& get() && noexcept
+		{
+			if constexpr (N == 0) return std::move(first);
+			else return std::move(rest).template get<N - 1>();
+		}
+	};
+
+	template<typename TCur, typename... TRemainTypes>
+	Aggregate<TCur, TRemainTypes...> MakeAggregate(const TCur& cur, const TRemainTypes&... remain)
+	{
+		if constexpr (sizeof...(TRemainTypes) == 0)
+			return { cur };
+		else
+			return { cur, MakeAggregate(remain...) };
+	}
+
+	///////////////////////////////////////////////////////
+	// Binary layout: the schema hash, then every value in tag order without padding,
+	// except that array payloads start at a multiple of their alignment from the
+	// beginning of the record, so that reading them as spans needs no copy when
+	// the record itself starts at an address aligned for them.
+	class Writer
+	{
+	public:
+		explicit Writer(std::vector<std::byte>& out) noexcept
+			: m_out(out), m_start(out.size())
+		{}
+		void Write(const void* data, size_t size)
+		{
+			const size_t pos = m_out.size();
+			m_out.resize(pos + size);
+			if (size != 0)
+				std::memcpy(m_out.data() + pos, data, size);
+		}
+		void Align(size_t alignment)
+		{
+			const size_t used = m_out.size() - m_start;
+			m_out.resize(m_start + (used + alignment - 1) / alignment * alignment);
+		}
+		void Reserve(size_t size)
+		{
+			m_out.reserve(m_out.size() + size);
+		}
+
+	private:
+		std::vector<std::byte>& m_out;
+		size_t m_start;
+	};
+
+	// Hands out pointers into the input, nullptr once it runs short
+	class Reader
+	{
+	public:
+		explicit Reader(std::span<const std::byte> in) noexcept
+			: m_in(in)
+		{}
+		const std::byte* Read(size_t size) noexcept
+		{
+			if (size > m_in.size() - m_pos)
+				return nullptr;
+			const std::byte* data = m_in.data() + m_pos;
+			m_pos += size;
+			return data;
+		}
+		bool Align(size_t alignment) noexcept
+		{
+			const size_t aligned = (m_pos + alignment - 1) / alignment * alignment;
+			if (aligned > m_in.size())
+				return false;
+			m_pos = aligned;
+			return true;
+		}
+		bool Done() const noexcept
+		{
+			return m_pos == m_in.size();
+		}
+
+	private:
+		std::span<const std::byte> m_in;
+		size_t m_pos = 0;
+	};
+
+	///////////////////////////////////////////////////////
+	// Opt a struct in to byte-wise coding once its bytes are the whole value:
+	// no pointers or views inside, no padding, no other invariants.
+	template<typename T>
+	constexpr bool IsPlainData = false;
+
+	template<typename T>
+	constexpr bool PlainBytes = std::is_arithmetic_v<T> || std::is_enum_v<T> || IsPlainData<T>;
+	template<typename T, size_t N>
+	constexpr bool PlainBytes<std::array<T, N>> = PlainBytes<T>;
+
+	// How a value type is written and read. Arithmetic and enum types, arrays of
+	// them and IsPlainData structs are copied byte-wise, specialise Codec for
+	// other types with
+	//   static void Write(Writer&, const T&) and static std::optional<T> Read(Reader&).
+	// Wire names the layout in the schema hash, so types sharing it can be read as each other.
+	template<typename T>
+	struct Codec
+	{
+		using Wire = T;
+		constexpr static bool Bulk = PlainBytes<T>;
+
+		static void Write(Writer& out, const T& value)
+		{
+			static_assert(Bulk, "No Codec for this value type, specialise NSVarTypeDict::Codec or IsPlainData.");
+			out.Write(&value, sizeof(T));
+		}
+		static std::optional<T> Read(Reader& in)
+		{
+			static_assert(Bulk, "No Codec for this value type, specialise NSVarTypeDict::Codec or IsPlainData.");
+			const std::byte* data = in.Read(sizeof(T));
+			if (!data)
+				return std::nullopt;
+			struct { std::byte bytes[sizeof(T)]; } raw;
+			std::memcpy(raw.bytes, data, sizeof(T));
+			return std::bit_cast<T>(raw);
+		}
+	};
+
+	// Types whose bytes are the value, so pointers and views never are
+	template<typename T>
+	constexpr bool IsBulk = requires { requires Codec<T>::Bulk; };
+
+	// A count followed by the elements in one block, read back in place
+	template<typename T>
+	struct Codec<std::span<const T>>
+	{
+		static_assert(IsBulk<T>, "Only spans of plain data types can be read in place.");
+		using Wire = std::span<const T>;
+
+		static void Write(Writer& out, std::span<const T> value)
+		{
+			const uint64_t count = value.size();
+			out.Write(&count, sizeof(count));
+			out.Align(alignof(T));
+			out.Write(value.data(), value.size_bytes());
+		}
+		// the span points into the input, which must outlive it and be aligned for T
+		static std::optional<std::span<const T>> Read(Reader& in)
+		{
+			auto bytes = ReadBytes(in);
+			if (!bytes || reinterpret_cast<uintptr_t>(bytes->data()) % alignof(T) != 0)
+				return std::nullopt;
+			return std::span<const T>(reinterpret_cast<const T*>(bytes->data()), bytes->size() / sizeof(T));
+		}
+		// a vector or a string holding a copy of the elements, from an input aligned or not
+		template<typename TOwner>
+		static std::optional<TOwner> ReadCopy(Reader& in)
+		{
+			auto bytes = ReadBytes(in);
+			if (!bytes)
+				return std::nullopt;
+			TOwner items(bytes->size() / sizeof(T), T());
+			if (!bytes->empty())
+				std::memcpy(items.data(), bytes->data(), bytes->size());
+			return items;
+		}
+
+	private:
+		// the block of elements, aligned from the start of the record only
+		static std::optional<std::span<const std::byte>> ReadBytes(Reader& in)
+		{
+			auto count = Codec<uint64_t>::Read(in);
+			if (!count || !in.Align(alignof(T)) || *count > SIZE_MAX / sizeof(T))
+				return std::nullopt;
+			const size_t size = static_cast<size_t>(*count) * sizeof(T);
+			const std::byte* data = in.Read(size);
+			if (!data)
+				return std::nullopt;
+			return std::span<const std::byte>(data, size);
+		}
+	};
+
+	template<typename TChar>
+	struct Codec<std::basic_string_view<TChar>>
+	{
+		using Wire = std::span<const TChar>;
+
+		static void Write(Writer& out, std::basic_string_view<TChar> value)
+		{
+			Codec<Wire>::Write(out, Wire(value.data(), value.size()));
+		}
+		static std::optional<std::basic_string_view<TChar>> Read(Reader& in)
+		{
+			auto chars = Codec<Wire>::Read(in);
+			if (!chars)
+				return std::nullopt;
+			return std::basic_string_view<TChar>(chars->data(), chars->size());
+		}
+	};
+
+	template<typename TChar>
+	struct Codec<std::basic_string<TChar>>
+	{
+		using Wire = std::span<const TChar>;
+
+		static void Write(Writer& out, const std::basic_string<TChar>& value)
+		{
+			Codec<Wire>::Write(out, Wire(value.data(), value.size()));
+		}
+		static std::optional<std::basic_string<TChar>> Read(Reader& in)
+		{
+			return Codec<Wire>::template ReadCopy<std::basic_string<TChar>>(in);
+		}
+	};
+
+	// In one block like a span for bulk elements, element by element otherwise
+	template<typename T>
+	struct Codec<std::vector<T>>
+	{
+		using Wire = std::conditional_t<IsBulk<T>, std::span<const T>, std::vector<typename Codec<T>::Wire>>;
+
+		static void Write(Writer& out, const std::vector<T>& value)
+		{
+			if constexpr (IsBulk<T>)
+				Codec<Wire>::Write(out, Wire(value));
+			else
+			{
+				const uint64_t count = value.size();
+				out.Write(&count, sizeof(count));
+				for (const T& item : value)
+					Codec<T>::Write(out, item);
+			}
+		}
+		static std::optional<std::vector<T>> Read(Reader& in)
+		{
+			if constexpr (IsBulk<T>)
+				return Codec<Wire>::template ReadCopy<std::vector<T>>(in);
+			else
+			{
+				auto count = Codec<uint64_t>::Read(in);
+				if (!count)
+					return std::nullopt;
+				std::vector<T> items;
+				for (uint64_t i = 0; i < *count; i++)
+				{
+					auto item = Codec<T>::Read(in);
+					if (!item)
+						return std::nullopt;
+					items.push_back(std::move(*item));
+				}
+				return items;
+			}
+		}
+	};
+
+	///////////////////////////////////////////////////////
+	// Type names come from the compiler, so the hash only matches between builds of the same compiler
+	template<typename T>
+	constexpr std::string_view TypeName()
+	{
+#if defined(_MSC_VER)
+		return __FUNCSIG__;
+#else
+		return __PRETTY_FUNCTION__;
+#endif
+	}
+
+	constexpr uint64_t Fnv1a(std::string_view text, uint64_t hash)
+	{
+		for (char c : text)
+		{
+			hash ^= static_cast<unsigned char>(c);
+			hash *= 0x100000001b3ULL;
+		}
+		return hash;
+	}
+
+	template<typename... TTypes>
+	constexpr uint64_t SchemaHash()
+	{
+		uint64_t hash = 0xcbf29ce484222325ULL;
+		((hash = Fnv1a(TypeName<TTypes>(), hash)), ...);
+		return hash;
+	}
+
+	///////////////////////////////////////////////////////
+	// How a value type is hashed, std::hash by default. Spans and vectors hash
+	// their elements, specialise Hasher with static size_t Hash(const T&) for
+	// types std::hash doesn't cover.
+	template<typename T>
+	struct Hasher
+	{
+		static size_t Hash(const T& value)
+		{
+			static_assert(std::is_default_constructible_v<std::hash<T>>,
+						  "No Hasher for this value type, specialise NSVarTypeDict::Hasher.");
+			return std::hash<T>{}(value);
+		}
+	};
+
+	constexpr uint64_t HashCombine(uint64_t seed, uint64_t value) noexcept
+	{
+		// boost::hash_combine widened to 64 bits
+		return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 12) + (seed >> 4));
+	}
+
+	template<typename T>
+	struct Hasher<std::span<const T>>
+	{
+		static size_t Hash(std::span<const T> value)
+		{
+			uint64_t hash = value.size();
+			for (const T& item : value)
+				hash = HashCombine(hash, Hasher<T>::Hash(item));
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	template<typename T>
+	struct Hasher<std::vector<T>>
+	{
+		static size_t Hash(const std::vector<T>& value)
+		{
+			return Hasher<std::span<const T>>::Hash(value);
+		}
+	};
+
+	// operator== where the type has one, element by element for spans
+	template<typename T>
+	bool Equal(const T& lhs, const T& rhs)
+	{
+		if constexpr (requires { { lhs == rhs } -> std::convertible_to<bool>; })
+			return lhs == rhs;
+		else
+			return std::ranges::equal(lhs, rhs, [](const auto& l, const auto& r) { return Equal(l, r); });
+	}
+
+	///////////////////////////////////////////////////////
+	// Roughly the bytes a value takes up, including what it owns on the heap
+	template<typename T>
+	size_t FootprintOf(const T&) noexcept
+	{
+		return sizeof(T);
+	}
+
+	template<typename TChar>
+	size_t FootprintOf(const std::basic_string<TChar>& value) noexcept
+	{
+		return sizeof(value) + value.capacity() * sizeof(TChar);
+	}
+
+	template<typename T>
+	size_t FootprintOf(const std::vector<T>& value) noexcept
+	{
+		size_t bytes = sizeof(value) + (value.capacity() - value.size()) * sizeof(T);
+		for (const T& item : value)
+			bytes += FootprintOf(item);
+		return bytes;
+	}
 } // namespace NSVarTypeDict
 
 
@@ -128,7 +531,122 @@ struct VarTypeDict
 		template<typename TTag>
 		using ValueType = NSVarTypeDict::Pos2Type<NSVarTypeDict::Tag2ID<TTag, TParameters...>, TTypes...>;
 
+		using AggregateType = NSVarTypeDict::Aggregate<TTypes...>;
+
+		// Copy the values into a plain struct, once every tag has been set
+		AggregateType Export() const
+		{
+			static_assert((!std::is_same_v<TTypes, NSVarTypeDict::NullParameter> && ...),
+						  "Every tag must be set before exporting.");
+			return Export(std::index_sequence_for<TTypes...>{});
+		}
+
+		// The tags and the wire layout of every value
+		constexpr static uint64_t Schema =
+			NSVarTypeDict::SchemaHash<TParameters..., typename NSVarTypeDict::Codec<TTypes>::Wire...>();
+
+		// Append the schema hash and the values to out
+		void Serialize(std::vector<std::byte>& out) const
+		{
+			using namespace NSVarTypeDict;
+			static_assert((!std::is_same_v<TTypes, NullParameter> && ...), "Every tag must be set before serializing.");
+
+			Writer writer(out);
+			// the fixed-size part goes in with one allocation at most
+			writer.Reserve(sizeof(Schema) + ((IsBulk<TTypes> ? sizeof(TTypes) : sizeof(uint64_t)) + ...));
+			writer.Write(&Schema, sizeof(Schema));
+			Serialize(writer, std::index_sequence_for<TTypes...>{});
+		}
+
+		// Values from a record written by Serialize, nothing if the schema or the size doesn't match.
+		// string_view and span values point into in, which must outlive them and start at an address
+		// aligned for their elements, such as the start of the vector or a multiple of
+		// alignof(std::max_align_t) into it; string and vector values are copied out from anywhere.
+		static std::optional<Values> Deserialize(std::span<const std::byte> in)
+		{
+			using namespace NSVarTypeDict;
+			static_assert((!std::is_same_v<TTypes, NullParameter> && ...), "Every tag must be set before deserializing.");
+
+			Reader reader(in);
+			auto schema = Codec<uint64_t>::Read(reader);
+			if (!schema || *schema != Schema)
+				return std::nullopt;
+			std::shared_ptr<void> values[sizeof...(TTypes)];
+			if (!Deserialize(reader, values, std::index_sequence_for<TTypes...>{}) || !reader.Done())
+				return std::nullopt;
+			return Values(std::move(values));
+		}
+
+		// The schema and every value hashed on its own, then combined in tag order
+		size_t Hash() const
+		{
+			static_assert((!std::is_same_v<TTypes, NSVarTypeDict::NullParameter> && ...), "Every tag must be set before hashing.");
+			return Hash(std::index_sequence_for<TTypes...>{});
+		}
+
+		// Equal when every value is, values shared between copies aren't compared
+		friend bool operator==(const Values& lhs, const Values& rhs)
+		{
+			static_assert((!std::is_same_v<TTypes, NSVarTypeDict::NullParameter> && ...), "Every tag must be set before comparing.");
+			return Equal(lhs, rhs, std::index_sequence_for<TTypes...>{});
+		}
+
+		// The values and their shared pointers, roughly, in bytes
+		size_t Footprint() const
+		{
+			static_assert((!std::is_same_v<TTypes, NSVarTypeDict::NullParameter> && ...), "Every tag must be set before measuring.");
+			return sizeof(Values) + Footprint(std::index_sequence_for<TTypes...>{});
+		}
+
 	private:
+		template<size_t... Is>
+		size_t Hash(std::index_sequence<Is...>) const
+		{
+			uint64_t hash = Schema;
+			((hash = NSVarTypeDict::HashCombine(hash,
+				NSVarTypeDict::Hasher<TTypes>::Hash(*static_cast<const TTypes*>(m_tuple[Is].get())))), ...);
+			return static_cast<size_t>(hash);
+		}
+
+		template<size_t... Is>
+		static bool Equal(const Values& lhs, const Values& rhs, std::index_sequence<Is...>)
+		{
+			return ((lhs.m_tuple[Is] == rhs.m_tuple[Is] ||
+					 NSVarTypeDict::Equal(*static_cast<const TTypes*>(lhs.m_tuple[Is].get()),
+										  *static_cast<const TTypes*>(rhs.m_tuple[Is].get()))) && ...);
+		}
+
+		template<size_t... Is>
+		size_t Footprint(std::index_sequence<Is...>) const
+		{
+			// every value sits next to a control block of about four pointers
+			return ((NSVarTypeDict::FootprintOf(*static_cast<const TTypes*>(m_tuple[Is].get())) + 4 * sizeof(void*)) + ... + 0);
+		}
+
+		template<size_t... Is>
+		void Serialize(NSVarTypeDict::Writer& writer, std::index_sequence<Is...>) const
+		{
+			(NSVarTypeDict::Codec<TTypes>::Write(writer, *static_cast<const TTypes*>(m_tuple[Is].get())), ...);
+		}
+
+		template<size_t... Is>
+		static bool Deserialize(NSVarTypeDict::Reader& reader, std::shared_ptr<void>(&values)[sizeof...(TTypes)],
+								std::index_sequence<Is...>)
+		{
+			return ([&] {
+				auto value = NSVarTypeDict::Codec<TTypes>::Read(reader);
+				if (value)
+					values[Is] = std::make_shared<TTypes>(std::move(*value));
+				return value.has_value();
+			}() && ...);
+		}
+
+		template<size_t... Is>
+		AggregateType Export(std::index_sequence<Is...>) const
+		{
+			return NSVarTypeDict::MakeAggregate(*static_cast<const TTypes*>(m_tuple[Is].get())...);
+		}
+
 		std::shared_ptr<void> m_tuple[sizeof...(TTypes)];
 	};
 
@@ -140,3 +658,14 @@ struct VarTypeDict
 		return type();
 	}
 };
+
+template<typename... TTypes>
+struct std::tuple_size<NSVarTypeDict::Aggregate<TTypes...>>
+	: std::integral_constant<size_t, sizeof...(TTypes)>
+{};
+
+template<size_t N, typename... TTypes>
+struct std::tuple_element<N, NSVarTypeDict::Aggregate<TTypes...>>
+{
+	using type = NSVarTypeDict::Pos2Type<N, TTypes...>;
+};
@@ -0,0 +1,124 @@
+﻿#include "VarTypeDict.h"
+
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <cstdlib>
+
+/*
+ * Round trip throughput of Serialize/Deserialize against writing the same
+ * fields by hand, which is what callers did before. The parameters are read
+ * back once as owning values and once as views into the record.
+ */
+
+// benchmarks are built with NDEBUG, so the results are checked without assert
+void Check(bool ok, const char* what)
+{
+	if (!ok)
+	{
+		std::cerr << "check failed: " << what << '\n';
+		std::exit(EXIT_FAILURE);
+	}
+}
+
+using Params = VarTypeDict<struct Id, struct Scale, struct Name, struct Samples>;
+
+template<typename TValues>
+void ByHand(const TValues& values, std::vector<std::byte>& out)
+{
+	auto put = [&](const void* data, size_t size) {
+		auto bytes = static_cast<const std::byte*>(data);
+		out.insert(out.end(), bytes, bytes + size);
+	};
+	const auto& name = values.template Get<Name>();
+	const auto& samples = values.template Get<Samples>();
+	const size_t name_size = name.size(), sample_count = samples.size();
+	put(&values.template Get<Id>(), sizeof(int));
+	put(&values.template Get<Scale>(), sizeof(double));
+	put(&name_size, sizeof(name_size));
+	put(name.data(), name.size());
+	put(&sample_count, sizeof(sample_count));
+	put(samples.data(), samples.size() * sizeof(float));
+}
+
+template<typename TValues>
+TValues ByHand(std::span<const std::byte> in)
+{
+	size_t pos = 0;
+	auto get = [&](void* data, size_t size) {
+		std::memcpy(data, in.data() + pos, size);
+		pos += size;
+	};
+	int id;
+	double scale;
+	size_t name_size, sample_count;
+	get(&id, sizeof(id));
+	get(&scale, sizeof(scale));
+	get(&name_size, sizeof(name_size));
+	std::string name(name_size, '\0');
+	get(name.data(), name_size);
+	get(&sample_count, sizeof(sample_count));
+	std::vector<float> samples(sample_count);
+	get(samples.data(), sample_count * sizeof(float));
+	return Params::Create()
+		.Set<Id>(id)
+		.Set<Scale>(scale)
+		.Set<Name>(std::move(name))
+		.Set<Samples>(std::move(samples));
+}
+
+template<typename F>
+double Measure(F&& round_trip, size_t record_size)
+{
+	constexpr size_t Rounds = 200'000;
+	std::vector<std::byte> buffer;
+	size_t checksum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < Rounds; i++)
+	{
+		buffer.clear();
+		checksum += round_trip(buffer);
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	Check(checksum == Rounds * 64, "every round trip reads back 64 samples");
+	return Rounds * record_size / elapsed.count() / (1 << 20); // MiB/s
+}
+
+int main()
+{
+	std::vector<float> samples(64);
+	std::iota(samples.begin(), samples.end(), 0.0F);
+	const auto values = Params::Create()
+		.Set<Id>(7)
+		.Set<Scale>(0.5)
+		.Set<Name>(std::string("a parameter set with a name longer than SSO"))
+		.Set<Samples>(samples);
+	using Values = std::remove_const_t<decltype(values)>;
+	// the reading side may declare views for the same layout
+	using Views = decltype(Params::Create()
+		.Set<Id>(0)
+		.Set<Scale>(0.0)
+		.Set<Name>(std::string_view())
+		.Set<Samples>(std::span<const float>()));
+	static_assert(Values::Schema == Views::Schema);
+
+	std::vector<std::byte> record;
+	values.Serialize(record);
+	const auto owned = Values::Deserialize(record);
+	const auto viewed = Views::Deserialize(record);
+	Check(owned && owned->Get<Name>() == values.Get<Name>(), "the name reads back");
+	Check(viewed && viewed->Get<Samples>()[63] == 63.0F, "the samples read back as a span");
+
+	std::cout << "by hand:         " << Measure([&](std::vector<std::byte>& buffer) {
+		ByHand(values, buffer);
+		return ByHand<Values>(buffer).Get<Samples>().size();
+	}, record.size()) << " MiB/s\n";
+	std::cout << "serialize:       " << Measure([&](std::vector<std::byte>& buffer) {
+		values.Serialize(buffer);
+		return Values::Deserialize(buffer)->Get<Samples>().size();
+	}, record.size()) << " MiB/s\n";
+	std::cout << "serialize/views: " << Measure([&](std::vector<std::byte>& buffer) {
+		values.Serialize(buffer);
+		return Views::Deserialize(buffer)->Get<Samples>().size();
+	}, record.size()) << " MiB/s\n";
+}
@@ -1,5 +1,7 @@
 ﻿#include <iostream>
 #include "VarTypeDict.h"
+#include "MemoCache.h"
+#include <thread>
 using namespace std;
 
 // 声明一个有三个键值对的异类词典
@@ -26,5 +28,81 @@ int main()
 		.Set<C>(2.3F)
 		.Set<B>(1));
 
+	// 全部赋值后可导出为普通结构体，支持结构化绑定，值类型均可平凡复制时可直接 memcpy
+	auto values = MyDict::Create()
+		.Set<A>(true)
+		.Set<B>(2)
+		.Set<C>(0.5F)
+		.Export();
+	static_assert(is_trivially_copyable_v<decltype(values)>);
+	auto [a, b, c] = values;
+	cout << a << ' ' << b << ' ' << c << endl; // 1 2 0.5
+
+	// 序列化为二进制，开头是由键与值类型生成的结构哈希；读取时字符串可直接引用缓冲区
+	auto named = MyDict::Create()
+		.Set<A>(string("name"))
+		.Set<B>(vector<int>{ 1, 2, 3 })
+		.Set<C>(4.5);
+	vector<byte> record;
+	named.Serialize(record);
+	auto view = decltype(MyDict::Create()
+		.Set<A>(string_view())
+		.Set<B>(vector<int>())
+		.Set<C>(0.0))::Deserialize(record);
+	cout << view->Get<A>() << ' ' << view->Get<B>().size() << ' ' << view->Get<C>() << endl; // name 3 4.5
+	record[0] ^= byte{ 1 };
+	cout << decltype(named)::Deserialize(record).has_value() << endl; // 0
+	// 记录可依次追加到同一缓冲区：string、vector 从任意偏移复制读出，string_view、span 要求记录起点按元素对齐
+	auto entry = MyDict::Create()
+		.Set<A>(string("hi"))
+		.Set<B>(vector<double>{ 1.5 })
+		.Set<C>('!');
+	vector<byte> log;
+	entry.Serialize(log);
+	const size_t second = log.size(); // 41
+	entry.Serialize(log);
+	auto first_back = decltype(entry)::Deserialize(span(log).first(second));
+	auto second_back = decltype(entry)::Deserialize(span(log).subspan(second));
+	auto second_view = decltype(MyDict::Create()
+		.Set<A>(string_view())
+		.Set<B>(span<const double>())
+		.Set<C>(' '))::Deserialize(span(log).subspan(second));
+	cout << (first_back == entry) << ' ' << (second_back == entry) << ' ' << second_view.has_value() << endl; // 1 1 0
+	// 只有算术、枚举类型及其 std::array 按字节写入，视图与指针不会；其他结构体需特化 NSVarTypeDict::IsPlainData 或 Codec
+	static_assert(NSVarTypeDict::IsBulk<array<float, 3>>);
+	static_assert(!NSVarTypeDict::IsBulk<string_view> && !NSVarTypeDict::IsBulk<span<const int>> && !NSVarTypeDict::IsBulk<const char*>);
+
+	// 全部赋值后可比较与哈希，每个值分别哈希后按键的顺序合并
+	auto same = MyDict::Create()
+		.Set<A>(string("name"))
+		.Set<B>(vector<int>{ 1, 2, 3 })
+		.Set<C>(4.5);
+	cout << (same == named) << ' ' << (same.Hash() == named.Hash()) << endl; // 1 1
+
+	// 以词典为键缓存计算结果：按哈希分片加锁，超出内存上限时淘汰最久未用的结果
+	memo_cache<decltype(named), double> cache(1 << 20);
+	auto slow_sum = [](const auto& params) {
+		double sum = params.template Get<C>();
+		for (int item : params.template Get<B>())
+			sum += item;
+		return sum;
+	};
+	vector<thread> threads;
+	for (int i = 0; i < 4; i++)
+		threads.emplace_back([&] { cache.get_or_compute(same, slow_sum); });
+	for (auto& t : threads)
+		t.join();
+	cout << *cache.get_or_compute(named, slow_sum) << ' ' << cache.misses() << ' ' << cache.hits() << endl; // 10.5 1 4
+
+	memo_cache<decltype(named), vector<char>> small(64 * 1024, 1);
+	for (int i = 0; i < 100; i++)
+	{
+		small.get_or_compute(MyDict::Create()
+			.Set<A>(string("block"))
+			.Set<B>(vector<int>{ i })
+			.Set<C>(0.0), [](const auto&) { return vector<char>(4096); });
+	}
+	cout << (small.size() < 16) << ' ' << (small.bytes() <= 64 * 1024) << endl; // 1 1
+
 	return 0;
 }